@@ -7,7 +7,7 @@ from __future__ import annotations
 from collections import defaultdict, Counter
 from random import choices
 import numpy as np
-from numba import njit, prange
+from numba import njit, prange, get_num_threads
 from typing import TYPE_CHECKING
 
 if TYPE_CHECKING:
@@ -15,10 +15,15 @@ if TYPE_CHECKING:
 
 # Import from the shared utility module
 from numba_utils import (
-    evaluate_21plus3_numba, 
-    evaluate_perfect_pairs_numba, 
-    evaluate_hot3_numba,
-    draw_card as draw_card_numba,
+    evaluate_21plus3_cards,
+    evaluate_perfect_pairs_cards,
+    evaluate_hot3_cards,
+    make_scratch_shoe,
+    make_undo_log,
+    draw_scratch_card,
+    draw_scratch_card_rng,
+    restore_scratch_shoe,
+    rng_stream_state,
 )
 
 def get_card_value(card: str) -> tuple[int, bool]:
@@ -133,30 +138,90 @@ def dealer_total_probabilities(
 
     return {total: count / simulations for total, count in final_totals.items()}
 
-@njit(parallel=True, cache=True)
+# Not cached: it reads the thread count at run time, which Numba cannot cache.
+@njit(parallel=True)
 def _run_side_bet_sim_chunk(shoe_counts: np.ndarray, rounds: int) -> np.ndarray:
     """Numba-jitted worker to simulate just the first 3 cards for side bet EV."""
     np.random.seed(np.random.randint(0, 1_000_000))
     results = np.zeros((rounds, 3), dtype=np.float64)
-
-    for i in prange(rounds):
-        temp_shoe = shoe_counts.copy()
+    n_blocks = min(rounds, get_num_threads())
+
+    for b in prange(n_blocks):
+        temp_shoe = make_scratch_shoe(shoe_counts)
+        undo_log = make_undo_log()
+        for i in range((rounds * b) // n_blocks, (rounds * (b + 1)) // n_blocks):
+            p1_idx = draw_scratch_card(temp_shoe, undo_log)
+            p2_idx = draw_scratch_card(temp_shoe, undo_log)
+            d1_idx = draw_scratch_card(temp_shoe, undo_log)
+            restore_scratch_shoe(temp_shoe, undo_log)
+
+            if -1 in (p1_idx, p2_idx, d1_idx): continue
+            _score_side_bets(p1_idx, p2_idx, d1_idx, results[i])
         
-        p1_idx = draw_card_numba(temp_shoe)
-        p2_idx = draw_card_numba(temp_shoe)
-        d1_idx = draw_card_numba(temp_shoe)
+    return results
 
+@njit(cache=True)
+def _score_side_bets(p1_idx: int, p2_idx: int, d1_idx: int, out: np.ndarray) -> None:
+    """Writes the perfect pairs, 21+3 and hot 3 outcomes of a deal into out."""
+    p1_rank, p2_rank, d_rank = p1_idx % 13, p2_idx % 13, d1_idx % 13
+    p1_suit, p2_suit, d_suit = p1_idx // 13, p2_idx // 13, d1_idx // 13
+    out[0] = evaluate_perfect_pairs_cards(p1_rank, p2_rank, p1_suit, p2_suit)
+    out[1] = evaluate_21plus3_cards(p1_rank, p2_rank, d_rank, p1_suit, p2_suit, d_suit)
+    out[2] = evaluate_hot3_cards(p1_rank, p2_rank, d_rank)
+
+# Column order of run_side_bet_batch's outputs.
+SIDE_BET_KEYS = ("perfect_pairs_ev", "21+3_ev", "hot3_ev")
+
+@njit(cache=True)
+def _accumulate_side_bets(shoe_counts: np.ndarray, seed: int, lo: int, hi: int, out: np.ndarray) -> None:
+    """Adds the side-bet outcome sums and squares of rounds [lo, hi) into out."""
+    rng = np.zeros(1, dtype=np.uint64)
+    outcome = np.zeros(3, dtype=np.float64)
+    temp_shoe = make_scratch_shoe(shoe_counts)
+    undo_log = make_undo_log()
+    for i in range(lo, hi):
+        rng[0] = rng_stream_state(seed, i)
+        p1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        p2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        restore_scratch_shoe(temp_shoe, undo_log)
         if -1 in (p1_idx, p2_idx, d1_idx): continue
 
-        p_ranks = np.array([p1_idx % 13, p2_idx % 13])
-        p_suits = np.array([p1_idx // 13, p2_idx // 13])
-        d_rank, d_suit = d1_idx % 13, d1_idx // 13
+        _score_side_bets(p1_idx, p2_idx, d1_idx, outcome)
+        for k in range(3):
+            out[0, k] += outcome[k]
+            out[1, k] += outcome[k] * outcome[k]
 
-        results[i, 0] = evaluate_perfect_pairs_numba(p_ranks, p_suits)
-        results[i, 1] = evaluate_21plus3_numba(p_ranks, d_rank, p_suits, d_suit)
-        results[i, 2] = evaluate_hot3_numba(p_ranks, d_rank)
-        
-    return results
+# Not cached: it reads the thread count at run time, which Numba cannot cache.
+@njit(parallel=True)
+def run_side_bet_batch(shoe_matrix: np.ndarray, rounds: int, seed: int, start_round: int) -> np.ndarray:
+    """
+    Side-bet outcomes for many shoes (rows of shoe_matrix) in a single parallel
+    launch. Returns a (tables, 2, 3) array of outcome sums and sums of squares in
+    the order perfect pairs, 21+3, hot 3, over rounds [start_round, start_round + rounds).
+    Every table uses the same counter-based streams (common random numbers).
+    With fewer tables than threads, each table's rounds are split into blocks
+    so every thread has work; the sums are exact, so the split never shows.
+    """
+    n_tables = shoe_matrix.shape[0]
+    blocks_per_table = max(1, min(rounds, get_num_threads() // max(n_tables, 1)))
+    n_tasks = n_tables * blocks_per_table
+    partial = np.zeros((max(n_tasks, 1), 2, 3), dtype=np.float64)
+
+    for task in prange(n_tasks):
+        t = task // blocks_per_table
+        b = task % blocks_per_table
+        lo = start_round + (rounds * b) // blocks_per_table
+        hi = start_round + (rounds * (b + 1)) // blocks_per_table
+        _accumulate_side_bets(shoe_matrix[t], seed, lo, hi, partial[task])
+
+    sums = np.zeros((n_tables, 2, 3), dtype=np.float64)
+    for task in range(n_tasks):
+        t = task // blocks_per_table
+        for k in range(3):
+            sums[t, 0, k] += partial[task, 0, k]
+            sums[t, 1, k] += partial[task, 1, k]
+    return sums
 
 def run_side_bet_simulation(shoe: 'Shoe', num_rounds: int = 50000) -> dict[str, float]:
     """
@@ -0,0 +1,336 @@
+"""
+Benchmark harness for the Numba kernels and the hot Python predictors.
+
+For every kernel it reports the first-call time (JIT compilation or cache
+load) separately from steady-state throughput, which is the median of several
+timed repeats after warm-up. Parallel kernels are also measured at 1..N
+threads. Results can be written as JSON and compared against a stored
+baseline; any kernel whose throughput drops by more than the tolerance is
+flagged and the process exits with status 1.
+
+    python benchmark.py --json bench.json
+    python benchmark.py --save-baseline baseline.json
+    python benchmark.py --baseline baseline.json --tolerance 0.10
+    python benchmark.py --tail-latency 50   # static vs dynamic block scheduling
+"""
+from __future__ import annotations
+import argparse
+import json
+import os
+import platform
+import statistics
+import sys
+import time
+
+import numba
+import numpy as np
+from numba import njit
+
+import bayesian_predictor
+import free_bet
+import numba_utils
+import shoe
+import shuffle_quality
+import shuffle_tracking
+import simulator
+import spanish21
+import switch
+import whole_shoe
+
+@njit(cache=True)
+def _bench_draw_card(shoe_counts: np.ndarray, draws: int) -> int:
+    """Draws and replaces `draws` cards so the composition stays fixed."""
+    checksum = 0
+    for _ in range(draws):
+        idx = numba_utils.draw_card(shoe_counts)
+        shoe_counts[idx] += 1
+        checksum += idx
+    return checksum
+
+@njit(cache=True)
+def _bench_draw_card_rng(shoe_counts: np.ndarray, draws: int, seed: int) -> int:
+    """Counter-based variant of _bench_draw_card."""
+    rng = np.zeros(1, dtype=np.uint64)
+    rng[0] = numba_utils.rng_stream_state(seed, 0)
+    checksum = 0
+    for _ in range(draws):
+        idx = numba_utils.draw_card_rng(shoe_counts, rng)
+        shoe_counts[idx] += 1
+        checksum += idx
+    return checksum
+
+@njit(cache=True)
+def _bench_scratch_draw(shoe_counts: np.ndarray, draws: int, seed: int) -> int:
+    """Scratch-shoe draws, restored from the undo log every four cards like a short round."""
+    rng = np.zeros(1, dtype=np.uint64)
+    rng[0] = numba_utils.rng_stream_state(seed, 0)
+    scratch = numba_utils.make_scratch_shoe(shoe_counts)
+    undo_log = numba_utils.make_undo_log()
+    checksum = 0
+    for i in range(draws):
+        checksum += numba_utils.draw_scratch_card_rng(scratch, undo_log, rng)
+        if i % 4 == 3: numba_utils.restore_scratch_shoe(scratch, undo_log)
+    return checksum
+
+@njit(cache=True)
+def _bench_hand_total(hands: np.ndarray) -> int:
+    checksum = 0
+    for i in range(hands.shape[0]):
+        total, is_soft = numba_utils.get_hand_total(hands[i])
+        checksum += total + (1 if is_soft else 0)
+    return checksum
+
+@njit(cache=True)
+def _bench_side_bet_evaluators(cards: np.ndarray) -> float:
+    """Runs all three side-bet evaluators over rows of (p1, p2, dealer) card indices."""
+    checksum = 0.0
+    for i in range(cards.shape[0]):
+        p_ranks = np.array([cards[i, 0] % 13, cards[i, 1] % 13])
+        p_suits = np.array([cards[i, 0] // 13, cards[i, 1] // 13])
+        d_rank, d_suit = cards[i, 2] % 13, cards[i, 2] // 13
+        checksum += numba_utils.evaluate_21plus3_numba(p_ranks, d_rank, p_suits, d_suit)
+        checksum += numba_utils.evaluate_perfect_pairs_numba(p_ranks, p_suits)
+        checksum += numba_utils.evaluate_hot3_numba(p_ranks, d_rank)
+    return checksum
+
+class KernelBenchmark:
+    """
+    A kernel call plus the number of operations (rounds, draws, ...) it
+    performs. setup builds the workload and returns the call; it runs once, on
+    prepare() or the first call, so benchmarks filtered out by --only build nothing.
+    """
+    def __init__(self, name: str, unit: str, ops: int, setup, parallel: bool = False):
+        self.name = name
+        self.unit = unit
+        self.ops = ops
+        self.setup = setup
+        self.parallel = parallel
+        self._call = None
+
+    def prepare(self) -> None:
+        if self._call is None: self._call = self.setup()
+
+    def call(self):
+        self.prepare()
+        return self._call()
+
+def default_benchmarks(scale: float = 1.0) -> list[KernelBenchmark]:
+    """The standard kernel suite; `scale` shrinks or grows every workload."""
+    fresh_shoe = shoe.Shoe(decks=8).get_remaining_cards()
+    shoe_counts = simulator.FastSimulator(fresh_shoe).shoe_counts
+    n = lambda base: max(1, int(base * scale))
+
+    rounds, draws, hands_n, sb_n, tables = n(250_000), n(2_000_000), n(1_000_000), n(500_000), 16
+    dealer_sims = n(5_000)
+    paths, path_rounds = n(20_000), 10
+    sequences, seq_shoes = n(200), 10
+    history_shoes = max(1, n(2_000) // 20) * 20
+
+    def spanish():
+        spanish_counts = spanish21.spanish_shoe_counts(shoe_counts=shoe_counts)
+        return lambda: spanish21.simulate_spanish_chunk(spanish_counts, rounds, 1, 0)
+
+    def switch_game():
+        t = switch.SwitchTables(shoe_counts)
+        return lambda: switch.simulate_switch_chunk(shoe_counts, rounds, 1, 0, t.hand_ev, t.play_two,
+                                                    t.play_more, t.split_pairs)
+
+    def batch(kernel):
+        shoe_matrix = np.repeat(shoe_counts[np.newaxis, :], tables, axis=0)
+        return lambda: kernel(shoe_matrix, rounds // tables, 1, 0)
+
+    def forecast(seats):
+        codes = simulator.seat_codes(seats)
+        return lambda: whole_shoe.forecast_paths(shoe_counts, path_rounds, paths, 1, 0, codes, codes)
+
+    def tracking():
+        casino_shuffle = shuffle_tracking.parse_procedure("casino")
+        return lambda: shuffle_tracking.simulate_tracking(6, sequences, seq_shoes, 1, casino_shuffle, 78,
+                                                          52, 26, 8, 8.0, False, 0)
+
+    def statistics_of_history():
+        casino_shuffle = shuffle_tracking.parse_procedure("casino")
+        history = shuffle_quality.record_sequences(6, 20, history_shoes // 20, 1, casino_shuffle, 234)
+        follows = np.ones(history.shape[0], dtype=np.bool_)
+        return lambda: shuffle_quality.shoe_statistics(history, history[0], follows, shuffle_quality.MAX_LAG)
+
+    def random_rows(high: int, size: int):
+        return np.random.default_rng(12345).integers(0, high, size=(size, 3)).astype(np.int64)
+
+    def hand_totals():
+        hands = random_rows(13, hands_n)
+        return lambda: _bench_hand_total(hands)
+
+    def side_bet_evaluators():
+        side_bet_cards = random_rows(52, sb_n)
+        return lambda: _bench_side_bet_evaluators(side_bet_cards)
+
+    return [
+        KernelBenchmark("simulate_chunk", "rounds", rounds,
+                        lambda: lambda: simulator.simulate_chunk(shoe_counts, rounds, 1, 0), parallel=True),
+        KernelBenchmark("simulate_chunk_diagnostics", "rounds", rounds,
+                        lambda: lambda: simulator.simulate_chunk_diagnostics(shoe_counts, rounds, 1, 0), parallel=True),
+        KernelBenchmark("simulate_free_bet_chunk", "rounds", rounds,
+                        lambda: lambda: free_bet.simulate_free_bet_chunk(shoe_counts, rounds, 1, 0), parallel=True),
+        KernelBenchmark("simulate_spanish_chunk", "rounds", rounds, spanish, parallel=True),
+        KernelBenchmark("simulate_switch_chunk", "rounds", rounds, switch_game, parallel=True),
+        KernelBenchmark("simulate_batch", "rounds", rounds, lambda: batch(simulator.simulate_batch), parallel=True),
+        KernelBenchmark("run_side_bet_batch", "rounds", rounds,
+                        lambda: batch(bayesian_predictor.run_side_bet_batch), parallel=True),
+        KernelBenchmark("forecast_paths", "rounds", paths * path_rounds, lambda: forecast(0), parallel=True),
+        KernelBenchmark("forecast_paths_6_seats", "rounds", paths * path_rounds,
+                        lambda: forecast(["basic", "never_bust", "mimic_dealer"]), parallel=True),
+        KernelBenchmark("simulate_tracking", "shoes", sequences * seq_shoes, tracking, parallel=True),
+        KernelBenchmark("shoe_statistics", "shoes", history_shoes, statistics_of_history, parallel=True),
+        KernelBenchmark("draw_card", "draws", draws, lambda: lambda: _bench_draw_card(shoe_counts.copy(), draws)),
+        KernelBenchmark("draw_card_rng", "draws", draws, lambda: lambda: _bench_draw_card_rng(shoe_counts.copy(), draws, 1)),
+        KernelBenchmark("draw_scratch_card_rng", "draws", draws, lambda: lambda: _bench_scratch_draw(shoe_counts, draws, 1)),
+        KernelBenchmark("get_hand_total", "hands", hands_n, hand_totals),
+        KernelBenchmark("side_bet_evaluators", "deals", sb_n, side_bet_evaluators),
+        KernelBenchmark("dealer_total_probabilities", "dealer hands", dealer_sims,
+                        lambda: lambda: bayesian_predictor.dealer_total_probabilities("10S", fresh_shoe, simulations=dealer_sims)),
+    ]
+
+def _thread_counts(max_threads: int) -> list[int]:
+    counts, k = [], 1
+    while k < max_threads:
+        counts.append(k)
+        k *= 2
+    return counts + [max_threads]
+
+def measure(bench: KernelBenchmark, repeats: int = 5) -> float:
+    """Median steady-state throughput in ops/second (call after warm-up)."""
+    times = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        bench.call()
+        times.append(time.perf_counter() - start)
+    return bench.ops / statistics.median(times)
+
+def run_benchmarks(benchmarks: list[KernelBenchmark], repeats: int = 5, max_threads: int | None = None) -> dict:
+    """Runs every benchmark and returns a JSON-serializable report."""
+    max_threads = max_threads or numba.config.NUMBA_NUM_THREADS
+    results = {}
+    for bench in benchmarks:
+        bench.prepare()
+        start = time.perf_counter()
+        bench.call()
+        first_call_s = time.perf_counter() - start
+
+        ops_per_s = measure(bench, repeats)
+        entry = {
+            "unit": bench.unit,
+            "ops": bench.ops,
+            "first_call_s": first_call_s,
+            "ops_per_s": ops_per_s,
+            "ns_per_op": 1e9 / ops_per_s,
+            "compile_overhead_s": max(0.0, first_call_s - bench.ops / ops_per_s),
+        }
+        if bench.parallel:
+            scaling = {}
+            try:
+                for threads in _thread_counts(max_threads):
+                    numba.set_num_threads(threads)
+                    bench.call()
+                    scaling[str(threads)] = measure(bench, repeats)
+            finally:
+                numba.set_num_threads(max_threads)
+            entry["scaling_ops_per_s"] = scaling
+        results[bench.name] = entry
+        print(f"{bench.name:<28} {ops_per_s:>14,.0f} {bench.unit}/s  {entry['ns_per_op']:>10,.1f} ns/op  "
+              f"first call {first_call_s:.2f}s", file=sys.stderr)
+
+    return {
+        "meta": {
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "python": platform.python_version(),
+            "numba": numba.__version__,
+            "numpy": np.__version__,
+            "machine": platform.machine(),
+            "cpu_count": os.cpu_count(),
+            "numba_threads": max_threads,
+        },
+        "results": results,
+    }
+
+GUI_JOB_ROUNDS = 250_000
+
+def _latency_summary(times_ms: list[float]) -> dict:
+    ordered = sorted(times_ms)
+    pick = lambda q: ordered[min(len(ordered) - 1, int(q / 100.0 * len(ordered)))]
+    return {"mean_ms": statistics.fmean(ordered), "p50_ms": pick(50), "p90_ms": pick(90),
+            "p99_ms": pick(99), "max_ms": ordered[-1]}
+
+def tail_latency(repeats: int = 30, rounds: int = GUI_JOB_ROUNDS) -> dict:
+    """
+    Wall-clock latency of the GUI's simulation job under static partitioning
+    (one block of rounds per thread) and under the dynamic block scheduler,
+    with a fresh seed per repeat so round-cost variation shows up in the tail.
+    """
+    shoe_counts = simulator.FastSimulator(shoe.Shoe(decks=8).get_remaining_cards()).shoe_counts
+    modes = {"static": 0, "dynamic": simulator.BLOCK_ROUNDS}
+    results = {}
+    for mode, block_rounds in modes.items():
+        simulator.simulate_chunk(shoe_counts, rounds, 0, 0, block_rounds)
+        times = []
+        for seed in range(1, repeats + 1):
+            start = time.perf_counter()
+            simulator.simulate_chunk(shoe_counts, rounds, seed, 0, block_rounds)
+            times.append((time.perf_counter() - start) * 1000.0)
+        results[mode] = _latency_summary(times)
+        print(f"{mode:<8} p50 {results[mode]['p50_ms']:8.2f} ms  p99 {results[mode]['p99_ms']:8.2f} ms  "
+              f"max {results[mode]['max_ms']:8.2f} ms", file=sys.stderr)
+    results["p99_speedup"] = results["static"]["p99_ms"] / results["dynamic"]["p99_ms"]
+    return {"rounds": rounds, "repeats": repeats, "block_rounds": simulator.BLOCK_ROUNDS, **results}
+
+def compare_to_baseline(report: dict, baseline: dict, tolerance: float = 0.10) -> list[str]:
+    """Returns a description of every kernel whose throughput regressed beyond tolerance."""
+    regressions = []
+    for name, entry in report["results"].items():
+        base = baseline.get("results", {}).get(name)
+        if not base: continue
+        pairs = [("steady state", entry["ops_per_s"], base["ops_per_s"])]
+        for threads, value in entry.get("scaling_ops_per_s", {}).items():
+            if threads in base.get("scaling_ops_per_s", {}):
+                pairs.append((f"{threads} threads", value, base["scaling_ops_per_s"][threads]))
+        for label, current, previous in pairs:
+            if current < previous * (1.0 - tolerance):
+                regressions.append(f"{name} ({label}): {current:,.0f} vs baseline {previous:,.0f} "
+                                   f"{entry['unit']}/s ({current / previous - 1.0:+.1%})")
+    return regressions
+
+def main(argv: list[str] | None = None) -> int:
+    parser = argparse.ArgumentParser(description="Benchmark the simulator kernels.")
+    parser.add_argument("--json", help="Write the report to this file.")
+    parser.add_argument("--baseline", help="Compare against this stored report.")
+    parser.add_argument("--save-baseline", help="Store this run's report as a baseline.")
+    parser.add_argument("--tolerance", type=float, default=0.10, help="Allowed fractional throughput drop.")
+    parser.add_argument("--repeats", type=int, default=5)
+    parser.add_argument("--scale", type=float, default=1.0, help="Workload size multiplier.")
+    parser.add_argument("--max-threads", type=int, default=None)
+    parser.add_argument("--only", nargs="*", help="Run only these kernels.")
+    parser.add_argument("--tail-latency", type=int, metavar="REPEATS", default=0,
+                        help="Also time the GUI's 250k-round job under static and dynamic scheduling.")
+    args = parser.parse_args(argv)
+
+    benchmarks = default_benchmarks(args.scale)
+    if args.only: benchmarks = [b for b in benchmarks if b.name in args.only]
+    report = run_benchmarks(benchmarks, args.repeats, args.max_threads)
+    if args.tail_latency: report["tail_latency"] = tail_latency(args.tail_latency)
+
+    for path in (args.json, args.save_baseline):
+        if path:
+            with open(path, "w") as f:
+                json.dump(report, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare_to_baseline(report, json.load(f), args.tolerance)
+        if regressions:
+            print("Performance regressions:", *regressions, sep="\n  ", file=sys.stderr)
+            return 1
+        print("No regressions against baseline.", file=sys.stderr)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
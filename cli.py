@@ -0,0 +1,347 @@
+"""
+Command-line batch runner for simulations and table generation, for running
+long jobs without the PyQt GUI.
+
+    python cli.py jobs.json --out results/ --format json
+
+The config file is JSON with optional "defaults" merged into every job:
+
+    {
+      "defaults": {"decks": 8, "seed": 12345},
+      "jobs": [
+        {"name": "fresh", "type": "simulate", "rounds": 50000000},
+        {"name": "rich", "type": "simulate", "rounds": 10000000, "removed": ["2S", "5H", "6D"]},
+        {"name": "sb", "type": "sidebets", "rounds": 5000000},
+        {"name": "idx", "type": "indices", "rounds": 200000, "tc_min": -8, "tc_max": 8},
+        {"name": "ror", "type": "ror", "rounds": 20000000, "bankroll_units": [100, 200, 500]},
+        {"name": "two_hands", "type": "spots", "rounds": 5000000, "spots": 3, "our_spots": [1, 2]},
+        {"name": "next10", "type": "forecast", "rounds": 10, "paths": 20000, "removed": ["5S", "6H"]},
+        {"name": "wong", "type": "backcount", "sessions": 20000, "tables": 4, "entry_tc": 2, "exit_tc": 0},
+        {"name": "team", "type": "team", "sessions": 20000, "tables": 4, "bet_spread": {"2": 10, "4": 20}}
+      ]
+    }
+
+Results are written per job as JSON, CSV or a columnar .npz file (one array
+per column). Progress goes to stderr. Simulation jobs checkpoint after every
+chunk, and finished jobs are recorded in <out>/manifest.json, so re-running
+the same command resumes where an interrupted run stopped.
+"""
+from __future__ import annotations
+import argparse
+import csv
+import json
+import os
+import random
+import sys
+import time
+
+import numpy as np
+
+import bayesian_predictor
+import decision_advisor
+import indices
+import multi_table
+import shoe
+import simulator
+import strategy
+import whole_shoe
+
+DEFAULT_CHUNK_ROUNDS = 1_000_000
+
+def _atomic_write_json(path: str, payload) -> None:
+    tmp_path = f"{path}.tmp"
+    with open(tmp_path, "w") as f:
+        json.dump(payload, f, indent=2)
+    os.replace(tmp_path, path)
+
+def _config_key(job: dict) -> str:
+    return json.dumps(job, sort_keys=True)
+
+class JobCheckpoint:
+    """Per-job resumable state, valid only for an identical job config."""
+    def __init__(self, path: str, job: dict):
+        self.path = path
+        self.job = job
+
+    def load(self) -> dict | None:
+        if not os.path.exists(self.path): return None
+        with open(self.path) as f:
+            data = json.load(f)
+        return data["state"] if data.get("config") == _config_key(self.job) else None
+
+    def save(self, state: dict) -> None:
+        _atomic_write_json(self.path, {"config": _config_key(self.job), "state": state})
+
+    def clear(self) -> None:
+        if os.path.exists(self.path): os.remove(self.path)
+
+class ProgressReporter:
+    """Prints a single updating progress line per job to stderr."""
+    def __init__(self, name: str, total: int, unit: str = "rounds", quiet: bool = False):
+        self.name = name
+        self.total = total
+        self.unit = unit
+        self.quiet = quiet
+        self.start_time = time.perf_counter()
+        self.start_done: int | None = None
+
+    def update(self, done: int) -> None:
+        if self.quiet: return
+        if self.start_done is None: self.start_done = done
+        elapsed = time.perf_counter() - self.start_time
+        rate = (done - self.start_done) / elapsed if elapsed > 0 else 0.0
+        eta = (self.total - done) / rate if rate > 0 else 0.0
+        pct = 100.0 * done / self.total if self.total else 100.0
+        sys.stderr.write(f"\r[{self.name}] {pct:5.1f}%  {done:,}/{self.total:,} {self.unit}  "
+                         f"{rate:,.0f} {self.unit}/s  ETA {eta:,.0f}s ")
+        if done >= self.total: sys.stderr.write("\n")
+        sys.stderr.flush()
+
+def build_shoe(job: dict) -> shoe.Shoe:
+    """The job's shoe: `decks` fresh decks minus any cards listed in `removed`."""
+    job_shoe = shoe.Shoe(decks=job.get("decks", 8))
+    for card in job.get("removed", []):
+        job_shoe.remove_card(card)
+    return job_shoe
+
+def build_shoe_dict(job: dict) -> dict[str, int]:
+    return build_shoe(job).get_remaining_cards()
+
+def _run_chunked_simulation(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> simulator.SimAccumulator:
+    """Runs a FastSimulator job chunk by chunk, checkpointing after each chunk."""
+    total_rounds = job["rounds"]
+    chunk_rounds = job.get("chunk_rounds", DEFAULT_CHUNK_ROUNDS)
+    sim = simulator.FastSimulator(build_shoe_dict(job), job.get("surrender", "none"), job.get("insurance_tc"))
+    state = checkpoint.load()
+
+    def on_checkpoint(ckpt: simulator.SimulationCheckpoint) -> None:
+        checkpoint.save(ckpt.to_dict())
+        progress.update(ckpt.next_round)
+
+    progress.update(state["next_round"] if state else 0)
+    return sim.run_checkpointed(
+        total_rounds, job.get("threads", 4), job.get("seed"), chunk_rounds,
+        resume=simulator.SimulationCheckpoint.from_dict(state) if state else None,
+        on_checkpoint=on_checkpoint)
+
+def run_simulate_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    accumulator = _run_chunked_simulation(job, checkpoint, progress)
+    means, errors, deviations = accumulator.mean(), accumulator.std_error(), accumulator.std_dev()
+    return [
+        {"bet": key, "ev": means[key], "std_error": errors[key], "std_dev": deviations[key], "rounds": accumulator.rounds}
+        for key in simulator.BET_KEYS
+    ]
+
+def run_sidebets_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    total_rounds = job["rounds"]
+    chunk_rounds = job.get("chunk_rounds", DEFAULT_CHUNK_ROUNDS)
+    shoe_matrix = simulator.FastSimulator(build_shoe_dict(job)).shoe_counts[np.newaxis, :].copy()
+
+    state = checkpoint.load() or {
+        "seed": job.get("seed", random.getrandbits(63)), "next_round": 0,
+        "sums": [[0.0] * 3, [0.0] * 3],
+    }
+    totals = np.asarray(state["sums"], dtype=np.float64)
+    progress.update(state["next_round"])
+    while state["next_round"] < total_rounds:
+        rounds = min(chunk_rounds, total_rounds - state["next_round"])
+        with simulator.numba_threads(job.get("threads", 4)):
+            totals += bayesian_predictor.run_side_bet_batch(shoe_matrix, rounds, state["seed"], state["next_round"])[0]
+        state["next_round"] += rounds
+        state["sums"] = totals.tolist()
+        checkpoint.save(state)
+        progress.update(state["next_round"])
+
+    rows = []
+    for k, key in enumerate(bayesian_predictor.SIDE_BET_KEYS):
+        mean = totals[0, k] / total_rounds
+        variance = max(totals[1, k] / total_rounds - mean * mean, 0.0)
+        rows.append({"bet": key, "ev": float(mean), "std_error": float(np.sqrt(variance / total_rounds)), "rounds": total_rounds})
+    return rows
+
+def run_indices_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    plays = job.get("plays") or list(decision_advisor.STRATEGY_CONFIG["index_plays"].keys())
+    configured = decision_advisor.STRATEGY_CONFIG["index_plays"]
+    tc_range = range(job.get("tc_min", -10), job.get("tc_max", 10) + 1)
+    state = checkpoint.load() or {"seed": job.get("seed", random.getrandbits(63)), "completed": []}
+    done = {row["play"] for row in state["completed"]}
+
+    progress.update(len(done))
+    for key in plays:
+        if key in done: continue
+        result = indices.generate_index(
+            key, configured[key]["action"], decks=job.get("decks", 8),
+            penetration=job.get("penetration", 0.5), tc_range=tc_range,
+            rounds=job.get("rounds", 200_000), seed=state["seed"])
+        row = {"play": key, "action": result["action"], "index": result["index"]}
+        row.update({f"gain_tc{tc}": gain for tc, gain in result["gain_by_tc"].items()})
+        state["completed"].append(row)
+        checkpoint.save(state)
+        progress.update(len(state["completed"]))
+    return state["completed"]
+
+def run_ror_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    accumulator = _run_chunked_simulation(job, checkpoint, progress)
+    ev, sd = accumulator.mean()["main_ev"], accumulator.std_dev()["main_ev"]
+    rows = [
+        {"bankroll_units": units, "ror": strategy.risk_of_ruin(ev, sd, units), "ev": ev, "std_dev": sd}
+        for units in job.get("bankroll_units", [100, 200, 500, 1000])
+    ]
+    for target in job.get("target_ror", [0.05, 0.01]):
+        rows.append({"bankroll_units": strategy.bankroll_for_risk(ev, sd, target), "ror": target, "ev": ev, "std_dev": sd})
+    return rows
+
+def run_spots_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    """
+    Kelly sizing for playing 1..len(our_spots) of our spots at once, from
+    run_spots' per-spot EV, variance and covariance. kelly_per_spot is the
+    fraction of bankroll to bet on each spot; independent_kelly_per_spot
+    ignores the shared dealer hand and shows how far that would overbet.
+    """
+    sim = simulator.FastSimulator(build_shoe_dict(job))
+    our_spots = job.get("our_spots", [0, 1])
+    result = sim.run_spots(job["rounds"], job.get("spots", 2), tuple(our_spots), job.get("threads", 4), job.get("seed"))
+    progress.update(job["rounds"])
+
+    means, covariance = np.asarray(result["ev_per_spot"]), np.asarray(result["covariance"])
+    rows = []
+    for k in range(1, len(our_spots) + 1):
+        played = our_spots[:k]
+        block = covariance[np.ix_(played, played)]
+        ev, variance = float(means[played].mean()), float(np.diag(block).mean())
+        pair_covariance = float((block.sum() - np.trace(block)) / (k * (k - 1))) if k > 1 else 0.0
+        kelly = strategy.kelly_spot_fraction(ev, variance, pair_covariance, k)
+        rows.append({
+            "spots_played": k, "ev_per_spot": ev, "variance_per_spot": variance, "covariance": pair_covariance,
+            "kelly_per_spot": kelly, "kelly_total": k * kelly,
+            "independent_kelly_per_spot": strategy.kelly_spot_fraction(ev, variance, 0.0, 1),
+            "rounds": result["rounds"],
+        })
+    return rows
+
+def run_forecast_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    forecast = whole_shoe.forecast_shoe(
+        build_shoe(job), job["rounds"], job.get("paths", 4_000), job.get("penetration", 0.75),
+        job.get("others_before", 0), job.get("others_after", 0), job.get("seed"))
+    progress.update(job["rounds"])
+
+    rows = []
+    for summary in forecast.round_summary():
+        row = {k: v for k, v in summary.items() if not isinstance(v, dict)}
+        for key in ("ev_quantiles", "cumulative_quantiles"):
+            row.update({f"{key[:-10]}_p{q}": v for q, v in summary.get(key, {}).items()})
+        rows.append(row)
+    return rows
+
+def run_backcount_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    spread = {int(k): float(v) for k, v in job["bet_spread"].items()} if job.get("bet_spread") else None
+    result = multi_table.simulate_backcounting(
+        job.get("tables", 4), job.get("entry_tc", 2.0), job.get("exit_tc", 0.0), job.get("hours", 1.0),
+        job["sessions"], job.get("decks", 8), job.get("penetration", 0.75), job.get("rounds_per_hour", 100),
+        others_before=job.get("others_before", 0), others_after=job.get("others_after", 0),
+        bet_spread=spread, seed=job.get("seed"))
+    progress.update(job["sessions"])
+    return [result]
+
+def run_team_job(job: dict, checkpoint: JobCheckpoint, progress: ProgressReporter) -> list[dict]:
+    spread = {int(k): float(v) for k, v in job["bet_spread"].items()} if job.get("bet_spread") else None
+    result = multi_table.simulate_team(
+        job.get("tables", 4), job.get("entry_tc", 2.0), job.get("exit_tc", 0.0), job.get("hours", 1.0),
+        job["sessions"], job.get("decks", 8), job.get("penetration", 0.75), job.get("rounds_per_hour", 100),
+        others_before=job.get("others_before", 0), others_after=job.get("others_after", 0),
+        spotter_bet=job.get("spotter_bet", 1.0), big_bet_spread=spread,
+        bankroll_units=job.get("bankroll_units", [500, 1000, 2000, 5000]), seed=job.get("seed"))
+    progress.update(job["sessions"])
+    ror = result.pop("risk_of_ruin")
+    return [dict(result, bankroll_units=units, ror=value) for units, value in ror.items()]
+
+JOB_RUNNERS = {
+    "simulate": run_simulate_job,
+    "sidebets": run_sidebets_job,
+    "indices": run_indices_job,
+    "ror": run_ror_job,
+    "spots": run_spots_job,
+    "forecast": run_forecast_job,
+    "backcount": run_backcount_job,
+    "team": run_team_job,
+}
+
+def write_results(path_base: str, fmt: str, job: dict, rows: list[dict]) -> str:
+    """Writes a job's result rows in the requested format and returns the file path."""
+    if fmt == "json":
+        path = f"{path_base}.json"
+        _atomic_write_json(path, {"job": job, "rows": rows})
+    elif fmt == "csv":
+        path = f"{path_base}.csv"
+        columns = list(dict.fromkeys(k for row in rows for k in row))
+        with open(path, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=columns)
+            writer.writeheader()
+            writer.writerows(rows)
+    elif fmt == "columnar":
+        path = f"{path_base}.npz"
+        columns = list(dict.fromkeys(k for row in rows for k in row))
+        arrays = {}
+        for column in columns:
+            values = [row.get(column) for row in rows]
+            if all(isinstance(v, (int, float)) and not isinstance(v, bool) for v in values):
+                arrays[column] = np.asarray(values, dtype=np.float64)
+            else:
+                arrays[column] = np.asarray(["" if v is None else str(v) for v in values])
+        np.savez(path, **arrays)
+    else:
+        raise ValueError(f"Unknown output format '{fmt}'.")
+    return path
+
+def run_config(config: dict, out_dir: str, fmt: str = "json", fresh: bool = False, quiet: bool = False) -> dict:
+    """Runs every job in the config, skipping ones already finished in out_dir."""
+    os.makedirs(out_dir, exist_ok=True)
+    manifest_path = os.path.join(out_dir, "manifest.json")
+    manifest = {}
+    if os.path.exists(manifest_path) and not fresh:
+        with open(manifest_path) as f:
+            manifest = json.load(f)
+
+    defaults = config.get("defaults", {})
+    for raw_job in config["jobs"]:
+        job = {**defaults, **raw_job}
+        name, job_type = job["name"], job["type"]
+        if job_type not in JOB_RUNNERS:
+            raise ValueError(f"Job '{name}' has unknown type '{job_type}'.")
+        entry = manifest.get(name)
+        if entry and entry["config"] == _config_key(job) and entry["format"] == fmt and os.path.exists(entry["output"]):
+            if not quiet: sys.stderr.write(f"[{name}] already complete, skipping\n")
+            continue
+
+        checkpoint = JobCheckpoint(os.path.join(out_dir, f"{name}.checkpoint.json"), job)
+        if fresh: checkpoint.clear()
+        if job_type == "indices":
+            total, unit = len(job.get("plays") or decision_advisor.STRATEGY_CONFIG["index_plays"]), "plays"
+        elif job_type in ("backcount", "team"):
+            total, unit = job["sessions"], "sessions"
+        else:
+            total, unit = job["rounds"], "rounds"
+        progress = ProgressReporter(name, total, unit, quiet)
+
+        rows = JOB_RUNNERS[job_type](job, checkpoint, progress)
+        output = write_results(os.path.join(out_dir, name), fmt, job, rows)
+        manifest[name] = {"config": _config_key(job), "format": fmt, "output": output}
+        _atomic_write_json(manifest_path, manifest)
+        checkpoint.clear()
+    return manifest
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Batch runner for Blackjack simulations and tables.")
+    parser.add_argument("config", help="JSON job configuration file.")
+    parser.add_argument("--out", default="results", help="Output directory (also holds checkpoints).")
+    parser.add_argument("--format", choices=("json", "csv", "columnar"), default="json")
+    parser.add_argument("--fresh", action="store_true", help="Ignore existing checkpoints and finished jobs.")
+    parser.add_argument("--quiet", action="store_true", help="Suppress progress output.")
+    args = parser.parse_args(argv)
+
+    with open(args.config) as f:
+        config = json.load(f)
+    run_config(config, args.out, args.format, args.fresh, args.quiet)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,289 @@
+"""
+Spreads a FastSimulator run across a pool of local worker processes and/or
+remote worker hosts. Rounds are split into shards; every round draws from its
+own counter-based random stream (see numba_utils.rng_stream_state), so each
+shard is reproducible on any worker and the merged accumulator is identical
+no matter how the shards were distributed.
+
+Remote hosts speak a minimal newline-delimited JSON protocol over TCP. Start
+a worker on each spare box (or on localhost as a stand-in) with:
+
+    python distributed.py serve --host 0.0.0.0 --port 5555
+"""
+from __future__ import annotations
+import argparse
+import json
+import multiprocessing
+import queue
+import random
+import socket
+import socketserver
+import threading
+from concurrent.futures import ProcessPoolExecutor
+
+import numpy as np
+
+import shoe
+import simulator
+
+DEFAULT_SHARD_ROUNDS = 250_000
+# Seconds a remote worker may take to connect or to answer one request; a
+# default-sized shard takes well under a second on a typical core.
+DEFAULT_WORKER_TIMEOUT = 120.0
+
+def run_shard(shoe_counts: list[int], seed: int, start_round: int, rounds: int,
+              surrender: str = "none", insurance_tc: float | None = None) -> dict:
+    """
+    Simulates one shard of rounds and returns its serialized accumulator.
+    surrender and insurance_tc are FastSimulator's rule arguments.
+    """
+    totals = simulator.simulate_chunk(
+        np.asarray(shoe_counts, dtype=np.int32), rounds, seed, start_round, simulator.BLOCK_ROUNDS,
+        simulator.SURRENDER_RULES.index(surrender), np.inf if insurance_tc is None else float(insurance_tc))
+    accumulator = simulator.SimAccumulator()
+    accumulator.add_chunk(totals, rounds)
+    return accumulator.to_dict()
+
+def _init_local_worker(numba_threads: int) -> None:
+    """Limits each worker process's Numba thread pool so processes don't oversubscribe cores."""
+    import numba
+    numba.set_num_threads(max(1, min(numba_threads, numba.config.NUMBA_NUM_THREADS)))
+
+class _ShardRequestHandler(socketserver.StreamRequestHandler):
+    """
+    Serves shard requests, one JSON object per line, until the client
+    disconnects. Each connection has its own thread, so shards run one at a
+    time under simulator.KERNEL_LAUNCH_LOCK.
+    """
+    def handle(self):
+        for line in self.rfile:
+            try:
+                request = json.loads(line)
+                op = request.get("op")
+                if op == "ping":
+                    response = {"ok": True}
+                elif op == "shard":
+                    with simulator.KERNEL_LAUNCH_LOCK:
+                        accumulator = run_shard(
+                            request["shoe_counts"], request["seed"], request["start_round"], request["rounds"],
+                            request.get("surrender", "none"), request.get("insurance_tc"))
+                    response = {"ok": True, "accumulator": accumulator}
+                else:
+                    response = {"ok": False, "error": f"Unknown op '{op}'."}
+            except Exception as e:
+                response = {"ok": False, "error": str(e)}
+            self.wfile.write((json.dumps(response) + "\n").encode())
+            self.wfile.flush()
+
+def serve_worker(host: str = "127.0.0.1", port: int = 5555) -> None:
+    """Runs a blocking shard worker server on (host, port)."""
+    socketserver.ThreadingTCPServer.allow_reuse_address = True
+    with socketserver.ThreadingTCPServer((host, port), _ShardRequestHandler) as server:
+        server.serve_forever()
+
+class RemoteWorker:
+    """
+    Client side of the shard protocol for a single worker host. A request
+    that fails or takes longer than timeout seconds drops the connection (a
+    late reply would otherwise be read as the next one's) and raises.
+    """
+    def __init__(self, host: str, port: int, timeout: float | None = DEFAULT_WORKER_TIMEOUT):
+        self.address = (host, port)
+        self.timeout = timeout
+        self._sock: socket.socket | None = None
+        self._reader = None
+
+    def __repr__(self) -> str:
+        return f"<RemoteWorker({self.address[0]}:{self.address[1]})>"
+
+    def _request(self, payload: dict) -> dict:
+        try:
+            if self._sock is None:
+                self._sock = socket.create_connection(self.address, timeout=self.timeout)
+                self._reader = self._sock.makefile("rb")
+            self._sock.sendall((json.dumps(payload) + "\n").encode())
+            line = self._reader.readline()
+            if not line:
+                raise ConnectionError(f"Worker {self.address[0]}:{self.address[1]} closed the connection.")
+            response = json.loads(line)
+        except socket.timeout:
+            self.close()
+            raise TimeoutError(f"Worker {self.address[0]}:{self.address[1]} did not answer within {self.timeout}s.")
+        except (OSError, ValueError):
+            self.close()
+            raise
+        if not response.get("ok"):
+            raise RuntimeError(f"Worker {self.address[0]}:{self.address[1]} failed: {response.get('error')}")
+        return response
+
+    def ping(self) -> bool:
+        """Returns True if the worker answers."""
+        return bool(self._request({"op": "ping"}).get("ok"))
+
+    def run_shard(self, shoe_counts: list[int], seed: int, start_round: int, rounds: int,
+                  surrender: str = "none", insurance_tc: float | None = None) -> dict:
+        """Runs one shard remotely and returns its serialized accumulator."""
+        return self._request({
+            "op": "shard", "shoe_counts": shoe_counts, "seed": seed,
+            "start_round": start_round, "rounds": rounds,
+            "surrender": surrender, "insurance_tc": insurance_tc,
+        })["accumulator"]
+
+    def close(self) -> None:
+        if self._sock is not None:
+            if self._reader is not None: self._reader.close()
+            self._sock.close()
+            self._sock = None
+            self._reader = None
+
+class DistributedSimulator:
+    """
+    Runs FastSimulator rounds across local worker processes and remote hosts,
+    merging their streaming accumulators. surrender and insurance_tc are
+    FastSimulator's rule arguments and are sent with every shard. A remote
+    host that takes longer than worker_timeout seconds to answer counts as
+    failed and its shard is re-queued.
+    """
+    def __init__(
+        self,
+        shoe_dict: dict[str, int],
+        processes: int = 0,
+        hosts: list[tuple[str, int]] | None = None,
+        shard_rounds: int = DEFAULT_SHARD_ROUNDS,
+        threads_per_process: int = 1,
+        surrender: str = "none",
+        insurance_tc: float | None = None,
+        worker_timeout: float | None = DEFAULT_WORKER_TIMEOUT
+    ):
+        if processes <= 0 and not hosts:
+            raise ValueError("At least one local process or remote host is required.")
+        if shard_rounds <= 0:
+            raise ValueError("shard_rounds must be a positive integer.")
+        fast = simulator.FastSimulator(shoe_dict, surrender, insurance_tc)
+        self.shoe_counts = fast.shoe_counts.tolist()
+        self.surrender, self.insurance_tc = fast.rules
+        self.processes = processes
+        self.hosts = list(hosts or [])
+        self.shard_rounds = shard_rounds
+        self.threads_per_process = threads_per_process
+        self.worker_timeout = worker_timeout
+        self.last_seed: int | None = None
+
+    def run(self, total_rounds: int, seed: int | None = None) -> dict[str, float]:
+        """Runs the distributed simulation and returns the mean EV for each bet type."""
+        return self.run_accumulated(total_rounds, seed).mean()
+
+    def run_accumulated(self, total_rounds: int, seed: int | None = None, start_round: int = 0) -> simulator.SimAccumulator:
+        """
+        Simulates rounds [start_round, start_round + total_rounds) of the seed's
+        stream. Each worker pulls shards from a shared queue, so faster boxes
+        take more of the work; shards from a failed remote host are re-queued.
+        """
+        self.last_seed = random.getrandbits(63) if seed is None else seed
+        seed = self.last_seed
+        accumulator = simulator.SimAccumulator()
+        if total_rounds <= 0: return accumulator
+
+        shards: queue.Queue = queue.Queue()
+        for lo in range(start_round, start_round + total_rounds, self.shard_rounds):
+            shards.put((lo, min(self.shard_rounds, start_round + total_rounds - lo)))
+        pending = shards.qsize()
+        lock = threading.Lock()
+        done = threading.Event()
+        errors: list[str] = []
+        live_workers = [self.processes + len(self.hosts)]
+
+        def finish_shard(result: dict) -> None:
+            nonlocal pending
+            with lock:
+                accumulator.merge(simulator.SimAccumulator.from_dict(result))
+                pending -= 1
+                if pending == 0: done.set()
+
+        def drain(execute) -> None:
+            try:
+                while not done.is_set():
+                    try:
+                        lo, rounds = shards.get(timeout=0.1)
+                    except queue.Empty:
+                        continue
+                    try:
+                        result = execute(lo, rounds)
+                    except Exception:
+                        shards.put((lo, rounds))
+                        raise
+                    finish_shard(result)
+            except Exception as e:
+                with lock:
+                    errors.append(str(e))
+                    live_workers[0] -= 1
+                    if live_workers[0] == 0: done.set()
+
+        context = multiprocessing.get_context("spawn")
+        executor = ProcessPoolExecutor(
+            max_workers=self.processes, mp_context=context,
+            initializer=_init_local_worker, initargs=(self.threads_per_process,)
+        ) if self.processes > 0 else None
+        remotes = [RemoteWorker(host, port, self.worker_timeout) for host, port in self.hosts]
+        try:
+            threads = []
+            for _ in range(self.processes):
+                threads.append(threading.Thread(target=drain, args=(
+                    lambda lo, n: executor.submit(
+                        run_shard, self.shoe_counts, seed, lo, n, self.surrender, self.insurance_tc).result(),)))
+            for remote in remotes:
+                threads.append(threading.Thread(target=drain, args=(
+                    lambda lo, n, r=remote: r.run_shard(
+                        self.shoe_counts, seed, lo, n, self.surrender, self.insurance_tc),)))
+            for t in threads: t.start()
+            for t in threads: t.join()
+        finally:
+            for remote in remotes: remote.close()
+            if executor is not None: executor.shutdown()
+
+        if pending > 0:
+            raise RuntimeError(f"All workers failed with {pending} shards outstanding: {'; '.join(errors)}")
+        return accumulator
+
+def _parse_host(value: str) -> tuple[str, int]:
+    host, _, port = value.rpartition(":")
+    return host or "127.0.0.1", int(port)
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Distributed Blackjack simulation workers.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    serve = sub.add_parser("serve", help="Run a shard worker server.")
+    serve.add_argument("--host", default="127.0.0.1")
+    serve.add_argument("--port", type=int, default=5555)
+
+    run = sub.add_parser("run", help="Run a full-shoe simulation across workers.")
+    run.add_argument("--rounds", type=int, default=10_000_000)
+    run.add_argument("--decks", type=int, default=8)
+    run.add_argument("--processes", type=int, default=0)
+    run.add_argument("--worker", action="append", default=[], help="Remote worker as host:port (repeatable).")
+    run.add_argument("--shard-rounds", type=int, default=DEFAULT_SHARD_ROUNDS)
+    run.add_argument("--seed", type=int, default=None)
+    run.add_argument("--worker-timeout", type=float, default=DEFAULT_WORKER_TIMEOUT,
+                     help="Seconds before an unresponsive remote worker is dropped.")
+    run.add_argument("--surrender", choices=simulator.SURRENDER_RULES, default="none")
+    run.add_argument("--insurance-tc", type=float, default=None, help="True count to take insurance at (default: never).")
+
+    args = parser.parse_args(argv)
+    if args.command == "serve":
+        serve_worker(args.host, args.port)
+        return
+
+    sim = DistributedSimulator(
+        shoe.Shoe(decks=args.decks).get_remaining_cards(), processes=args.processes,
+        hosts=[_parse_host(w) for w in args.worker], shard_rounds=args.shard_rounds,
+        surrender=args.surrender, insurance_tc=args.insurance_tc, worker_timeout=args.worker_timeout
+    )
+    accumulator = sim.run_accumulated(args.rounds, args.seed)
+    errors = accumulator.std_error()
+    print(f"Seed {sim.last_seed}, {accumulator.rounds} rounds")
+    for key, ev in accumulator.mean().items():
+        print(f"  {key:<18} {ev:+.5f} ± {1.96 * errors.get(key, 0.0):.5f}")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,240 @@
+"""
+Optimal table-exit (wong-out) policy. Shoes are dealt start to finish with the
+whole-shoe engine, and every round is reduced to a state of (Hi-Lo true count,
+penetration bucket). From those paths we estimate each state's expected
+result and its transition probabilities, including the end of the shoe. A
+dynamic program then chooses stay or leave in every state to maximize the
+long-run win rate per round. Leaving costs `switch_rounds` rounds of time
+to find a new table, and reshuffling costs `shuffle_rounds`.
+
+The win rate is found with a renewal argument. A cycle runs from a fresh
+shoe until we leave or the shoe ends. For a trial win rate g, value iteration
+gives each state's expected cycle result with g charged per round. The
+optimal g is the one at which a fresh shoe is worth exactly zero, and it is
+found by bisection.
+
+The result is a small stay/leave table that StrategyAdvisor consults each round.
+
+    python exit_policy.py --out exit_policy.json
+"""
+from __future__ import annotations
+import argparse
+import json
+import math
+import random
+
+import numpy as np
+
+import shoe
+import simulator
+import whole_shoe
+
+# Each state's average result is shrunk toward the linear EV-by-true-count fit
+# with this many pseudo-visits, which steadies rarely visited states.
+SHRINK_VISITS = 50
+
+class ExitPolicy:
+    """Stay/leave decision per (true count, penetration) bucket."""
+    def __init__(
+        self, tc_min: int, tc_max: int, penetration: float, stay: np.ndarray,
+        visits: np.ndarray, advantage: np.ndarray, win_rate: float, meta: dict | None = None
+    ):
+        self.tc_min = tc_min
+        self.tc_max = tc_max
+        self.penetration = penetration
+        self.stay = np.asarray(stay, dtype=bool)
+        self.visits = np.asarray(visits, dtype=np.int64)
+        self.advantage = np.asarray(advantage, dtype=np.float64)
+        self.win_rate = win_rate
+        self.meta = meta or {}
+
+    def __repr__(self) -> str:
+        return f"<ExitPolicy(tc={self.tc_min}..{self.tc_max}, pen_buckets={self.n_pen_buckets}, win_rate={self.win_rate:+.5f})>"
+
+    @property
+    def n_pen_buckets(self) -> int:
+        return self.stay.shape[1]
+
+    def bucket(self, true_count: float, dealt_fraction: float) -> tuple[int, int]:
+        """Table indices for a (floored) true count and the fraction of the full shoe dealt."""
+        tc = min(max(math.floor(true_count), self.tc_min), self.tc_max)
+        pen = min(self.n_pen_buckets - 1, max(0, int(dealt_fraction / self.penetration * self.n_pen_buckets)))
+        return tc - self.tc_min, pen
+
+    def should_stay(self, true_count: float, dealt_fraction: float) -> bool:
+        return bool(self.stay[self.bucket(true_count, dealt_fraction)])
+
+    def advice(self, true_count: float, dealt_fraction: float) -> str:
+        i, j = self.bucket(true_count, dealt_fraction)
+        action = "Stay" if self.stay[i, j] else "Leave the table"
+        return (f"{action} (TC {i + self.tc_min:+d}, {dealt_fraction:.0%} dealt; "
+                f"state EV {self.advantage[i, j]:+.2%}, policy win rate {self.win_rate:+.3%}/round)")
+
+    def format_table(self) -> str:
+        """Rows are true counts, columns penetration buckets; S = stay, L = leave, . = never observed."""
+        edges = [f"{self.penetration * (j + 1) / self.n_pen_buckets:.0%}" for j in range(self.n_pen_buckets)]
+        lines = ["TC   " + " ".join(f"{e:>4}" for e in edges)]
+        for i in range(self.stay.shape[0]):
+            cells = ("   ." if self.visits[i, j] == 0 else ("   S" if self.stay[i, j] else "   L") for j in range(self.n_pen_buckets))
+            lines.append(f"{i + self.tc_min:+3d}  " + " ".join(cells))
+        return "\n".join(lines)
+
+    def to_dict(self) -> dict:
+        return {
+            "tc_min": self.tc_min, "tc_max": self.tc_max, "penetration": self.penetration,
+            "stay": self.stay.astype(int).tolist(), "visits": self.visits.tolist(),
+            "advantage": self.advantage.tolist(), "win_rate": self.win_rate, "meta": self.meta,
+        }
+
+    @classmethod
+    def from_dict(cls, data: dict) -> 'ExitPolicy':
+        return cls(data["tc_min"], data["tc_max"], data["penetration"], data["stay"],
+                   data["visits"], data["advantage"], data["win_rate"], data.get("meta"))
+
+    def save(self, path: str) -> None:
+        with open(path, "w") as f:
+            json.dump(self.to_dict(), f, indent=2)
+
+    @classmethod
+    def load(cls, path: str) -> 'ExitPolicy':
+        with open(path) as f:
+            return cls.from_dict(json.load(f))
+
+def estimate_transitions(
+    forecast: whole_shoe.ShoeForecast, full_cards: int, penetration: float,
+    tc_min: int, tc_max: int, n_pen_buckets: int, bet_units: np.ndarray
+) -> dict:
+    """
+    Reduces whole-shoe paths to per-state visit counts, bet-weighted reward
+    sums, a transition count matrix whose last column is the end of the shoe,
+    and the distribution of starting states.
+    """
+    n_tc = tc_max - tc_min + 1
+    n_states = n_tc * n_pen_buckets
+    played = forecast.played
+    tc_idx = np.clip(np.floor(np.nan_to_num(forecast.true_counts)), tc_min, tc_max).astype(np.int64) - tc_min
+    dealt = 1.0 - forecast.cards_left / full_cards
+    pen_idx = np.clip((dealt / penetration * n_pen_buckets).astype(np.int64), 0, n_pen_buckets - 1)
+    state = tc_idx * n_pen_buckets + pen_idx
+
+    next_state = np.full(state.shape, n_states, dtype=np.int64)
+    next_state[:, :-1] = np.where(played[:, 1:], state[:, 1:], n_states)
+
+    s, ns = state[played], next_state[played]
+    rewards = forecast.outcomes[played] * bet_units[tc_idx[played]]
+    visits = np.bincount(s, minlength=n_states)
+    transitions = np.zeros((n_states, n_states + 1))
+    np.add.at(transitions, (s, ns), 1.0)
+    return {
+        "visits": visits,
+        "reward_sums": np.bincount(s, weights=rewards, minlength=n_states),
+        "transitions": transitions,
+        "start": np.bincount(state[played[:, 0], 0], minlength=n_states) / max(1, int(played[:, 0].sum())),
+    }
+
+def _cycle_values(
+    g: float, rewards: np.ndarray, p_next: np.ndarray, p_end: np.ndarray,
+    switch_rounds: float, shuffle_rounds: float, tol: float = 1e-10, max_iter: int = 10_000
+) -> tuple[np.ndarray, np.ndarray]:
+    """Expected cycle result of each state with g charged per round; returns (values, stay flags)."""
+    values = np.zeros(rewards.shape[0])
+    leave = -g * switch_rounds
+    for _ in range(max_iter):
+        play = rewards - g + p_next @ values - p_end * g * shuffle_rounds
+        updated = np.maximum(play, leave)
+        if np.max(np.abs(updated - values)) < tol:
+            values = updated
+            break
+        values = updated
+    return values, play >= leave
+
+def solve_policy(
+    stats: dict, ev_fit: tuple[float, float], tc_min: int, bet_units: np.ndarray, n_pen_buckets: int,
+    switch_rounds: float = 2.0, shuffle_rounds: float = 2.0, tol: float = 1e-7
+) -> tuple[float, np.ndarray, np.ndarray]:
+    """Bisects for the optimal win rate; returns (win rate, stay flags, per-state advantage)."""
+    visits = stats["visits"].astype(np.float64)
+    n_states = visits.shape[0]
+    tc_of_state = np.arange(n_states) // n_pen_buckets
+    prior = (ev_fit[0] + ev_fit[1] * (tc_of_state + tc_min)) * bet_units[tc_of_state]
+    rewards = (stats["reward_sums"] + SHRINK_VISITS * prior) / (visits + SHRINK_VISITS)
+
+    row_totals = stats["transitions"].sum(axis=1)
+    probabilities = np.divide(stats["transitions"], row_totals[:, None],
+                              out=np.zeros_like(stats["transitions"]), where=row_totals[:, None] > 0)
+    # Unvisited states are never entered; give them a certain end of shoe so the iteration stays proper.
+    probabilities[row_totals == 0, n_states] = 1.0
+    p_next, p_end = probabilities[:, :n_states], probabilities[:, n_states]
+
+    lo, hi = -2.0 * float(bet_units.max()), 2.0 * float(bet_units.max())
+    while hi - lo > tol:
+        g = 0.5 * (lo + hi)
+        values, _ = _cycle_values(g, rewards, p_next, p_end, switch_rounds, shuffle_rounds)
+        if stats["start"] @ values > 0: lo = g
+        else: hi = g
+    _, stay = _cycle_values(lo, rewards, p_next, p_end, switch_rounds, shuffle_rounds)
+    return lo, stay, rewards
+
+def build_exit_policy(
+    decks: int = 8,
+    penetration: float = 0.75,
+    n_shoes: int = 20_000,
+    tc_min: int = -6,
+    tc_max: int = 6,
+    n_pen_buckets: int = 8,
+    switch_rounds: float = 2.0,
+    shuffle_rounds: float = 2.0,
+    bet_spread: dict[int, float] | None = None,
+    others_before: int | list[str] = 0,
+    others_after: int | list[str] = 0,
+    seed: int | None = None
+) -> ExitPolicy:
+    """
+    Deals n_shoes full shoes to the cut card and solves the exit policy.
+    bet_spread maps a true count to the bet in units (counts below the lowest
+    key bet that key's amount; default flat 1 unit).
+    """
+    n_tc = tc_max - tc_min + 1
+    bet_units = whole_shoe.bet_ramp(tc_min, tc_max, bet_spread)
+
+    fresh = shoe.Shoe(decks=decks)
+    seed = random.getrandbits(63) if seed is None else seed
+    max_rounds = int(fresh.initial_card_count * penetration) // 4 + 2
+    forecast = whole_shoe.forecast_shoe(fresh, max_rounds, n_shoes, penetration, others_before, others_after, seed)
+    if forecast.played[:, -1].any():
+        raise RuntimeError("Round limit reached before the cut card; increase max_rounds.")
+
+    stats = estimate_transitions(forecast, fresh.initial_card_count, penetration, tc_min, tc_max, n_pen_buckets, bet_units)
+    win_rate, stay, rewards = solve_policy(stats, forecast.ev_by_true_count(), tc_min, bet_units,
+                                           n_pen_buckets, switch_rounds, shuffle_rounds)
+    meta = {"decks": decks, "shoes": n_shoes, "seed": seed, "switch_rounds": switch_rounds,
+            "shuffle_rounds": shuffle_rounds, "others_before": others_before, "others_after": others_after,
+            "bet_units": bet_units.tolist()}
+    return ExitPolicy(tc_min, tc_max, penetration, stay.reshape(n_tc, n_pen_buckets),
+                      stats["visits"].reshape(n_tc, n_pen_buckets), rewards.reshape(n_tc, n_pen_buckets),
+                      win_rate, meta)
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Solve the optimal table-exit policy.")
+    parser.add_argument("--out", default="exit_policy.json")
+    parser.add_argument("--decks", type=int, default=8)
+    parser.add_argument("--penetration", type=float, default=0.75)
+    parser.add_argument("--shoes", type=int, default=20_000)
+    parser.add_argument("--switch-rounds", type=float, default=2.0, help="Rounds lost finding a new table.")
+    parser.add_argument("--spread", help='Bet spread as JSON, e.g. \'{"1": 1, "2": 4, "4": 8}\'.')
+    parser.add_argument("--others", type=int, default=0, help="Other players (half act before us).")
+    parser.add_argument("--others-strategy", choices=simulator.SEAT_STRATEGIES, default="basic")
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args(argv)
+
+    spread = {int(k): float(v) for k, v in json.loads(args.spread).items()} if args.spread else None
+    policy = build_exit_policy(
+        args.decks, args.penetration, args.shoes, switch_rounds=args.switch_rounds, bet_spread=spread,
+        others_before=[args.others_strategy] * (args.others // 2),
+        others_after=[args.others_strategy] * (args.others - args.others // 2), seed=args.seed)
+    policy.save(args.out)
+    print(policy.format_table())
+    print(f"Win rate under the policy: {policy.win_rate:+.4%} units per round")
+
+if __name__ == "__main__":
+    main()
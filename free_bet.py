@@ -0,0 +1,295 @@
+"""
+Free Bet Blackjack. The house puts up the extra wager for two-card doubles on
+hard 9, 10 and 11 and for splits of any pair but tens; the player wins the
+free chip's payout on a winning hand and loses nothing for it otherwise. In
+exchange a dealer total of 22 pushes every hand still standing (a player
+blackjack is settled before the dealer draws and still pays 3:2).
+
+The engine shares the scratch shoe, card drawing and hand-state kernels of
+simulator.py, the dealer stands on all 17s as there, and it plays one split
+per spot like the standard engine. Each hand is carried as (total, paid
+units, free units). dealer_distribution gives the exact final-total
+distribution of the dealer, 22 included, for a rank composition.
+
+    python free_bet.py --decks 6 --rounds 10000000
+"""
+from __future__ import annotations
+import argparse
+import json
+import random
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+import shoe
+import simulator
+from numba_utils import (
+    add_card_to_hand, hand_state_total, make_scratch_shoe, make_undo_log,
+    draw_scratch_card_rng, restore_scratch_shoe, rng_stream_state,
+)
+from simulator import BLOCK_ROUNDS, num_blocks, reduce_blocks, _play_dealer_hand, _should_double
+
+# Columns of the per-round outcome vector. main_ev is the whole round's result;
+# free_bet_ev is the part of it won by free chips and push_22_ev what the dealer's
+# 22 pushes took from hands that would otherwise have won.
+FREE_BET_KEYS = ("main_ev", "free_bet_ev", "push_22_ev")
+NUM_FREE_BET_KEYS = len(FREE_BET_KEYS)
+FB_MAIN, FB_FREE, FB_PUSH_22 = range(NUM_FREE_BET_KEYS)
+
+# Dealer outcomes of dealer_distribution: final totals 17-21, 22, 23 or more, and a natural.
+DEALER_OUTCOMES = ("17", "18", "19", "20", "21", "22", "bust", "blackjack")
+DEALER_22, DEALER_BUST, DEALER_BLACKJACK = 5, 6, 7
+NUM_CATEGORIES = 10  # A, 2-9, ten
+
+@njit(cache=True)
+def _takes_free_double(hand_val: int, is_soft: bool) -> bool:
+    """Free doubles are offered, and always taken, on two-card hard 9, 10 and 11."""
+    return not is_soft and 9 <= hand_val <= 11
+
+@njit(cache=True)
+def _takes_free_split(pair_rank: int) -> bool:
+    """Every free split is taken; tens are not offered one and 5-5 is free doubled instead."""
+    return pair_rank < 9 and pair_rank != 4
+
+@njit(cache=True)
+def _free_bet_should_stand(player_total: int, is_soft: bool, dealer_up_rank: int) -> bool:
+    """
+    Standing strategy below 21. A dealer bust is worth less when 22 pushes, so
+    stiff hands hit more often than in the standard engine: 12 stands only
+    against 5 and 6 and 13 against 3 to 6.
+    """
+    weak_up = 1 <= dealer_up_rank <= 5
+    if is_soft: return player_total >= 19 or (player_total == 18 and 1 <= dealer_up_rank <= 7)
+    if player_total >= 17: return True
+    if player_total >= 14: return weak_up
+    if player_total == 13: return weak_up and dealer_up_rank >= 2
+    return player_total == 12 and dealer_up_rank in (4, 5)
+
+@njit(cache=True)
+def _play_free_bet_hand(
+    hard_total: int, aces: int, paid: float, free: float, temp_shoe: np.ndarray, undo_log: np.ndarray,
+    dealer_up_rank: int, rng: np.ndarray
+) -> tuple[int, float, float]:
+    """
+    Plays a two-card hand carrying `paid` player units and `free` house units.
+    Hard 9-11 get a free double; soft hands double with the player's money
+    where the standard engine would. Returns (final total, paid, free).
+    """
+    hand_val, is_soft = hand_state_total(hard_total, aces)
+    free_double = _takes_free_double(hand_val, is_soft)
+    if free_double or (is_soft and _should_double(hand_val, is_soft, dealer_up_rank)):
+        if free_double: free += 1.0
+        else: paid += 1.0
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx != -1: hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+        return hand_state_total(hard_total, aces)[0], paid, free
+
+    while True:
+        player_total, is_soft = hand_state_total(hard_total, aces)
+        if player_total >= 21 or _free_bet_should_stand(player_total, is_soft, dealer_up_rank):
+            return player_total, paid, free
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1: return player_total, paid, free
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+
+@njit(cache=True)
+def _settle_free_bet_hand(player_total: int, dealer_total: int, paid: float, free: float, row: np.ndarray) -> None:
+    """Adds one finished hand to the round's outcome row. Free units never lose."""
+    if player_total > 21:
+        row[FB_MAIN] -= paid
+    elif dealer_total == 22:
+        row[FB_PUSH_22] -= paid + free
+    elif dealer_total > 22 or player_total > dealer_total:
+        row[FB_MAIN] += paid + free
+        row[FB_FREE] += free
+    elif player_total < dealer_total:
+        row[FB_MAIN] -= paid
+
+@njit(cache=True)
+def _simulate_free_bet_round(temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, row: np.ndarray) -> None:
+    """
+    Plays one Free Bet round from the scratch shoe into row (left at 0.0 if
+    the shoe runs dry while dealing). Cards are drawn in the same order as the
+    standard engine's _simulate_round.
+    """
+    p1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    p2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d_hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if -1 in (p1_idx, p2_idx, d1_idx, d_hole_idx): return
+
+    p1_rank, p2_rank, d_rank = p1_idx % 13, p2_idx % 13, d1_idx % 13
+    p_hard, p_aces = add_card_to_hand(0, 0, p1_rank)
+    p_hard, p_aces = add_card_to_hand(p_hard, p_aces, p2_rank)
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    dealer_blackjack = hand_state_total(d_hard, d_aces)[0] == 21
+    if hand_state_total(p_hard, p_aces)[0] == 21:
+        row[FB_MAIN] = 0.0 if dealer_blackjack else 1.5
+        return
+    if dealer_blackjack:
+        row[FB_MAIN] = -1.0
+        return
+
+    t2, paid2, free2 = 0, 0.0, 0.0
+    if p1_rank == p2_rank and _takes_free_split(p1_rank):
+        h1_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        h2_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if h1_card_idx == -1 or h2_card_idx == -1: return
+        h_hard, h_aces = add_card_to_hand(0, 0, p1_rank)
+        h_hard, h_aces = add_card_to_hand(h_hard, h_aces, h1_card_idx % 13)
+        t1, paid1, free1 = _play_free_bet_hand(h_hard, h_aces, 1.0, 0.0, temp_shoe, undo_log, d_rank, rng)
+        h_hard, h_aces = add_card_to_hand(0, 0, p1_rank)
+        h_hard, h_aces = add_card_to_hand(h_hard, h_aces, h2_card_idx % 13)
+        t2, paid2, free2 = _play_free_bet_hand(h_hard, h_aces, 0.0, 1.0, temp_shoe, undo_log, d_rank, rng)
+    else:
+        t1, paid1, free1 = _play_free_bet_hand(p_hard, p_aces, 1.0, 0.0, temp_shoe, undo_log, d_rank, rng)
+
+    dealer_final, _ = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+    _settle_free_bet_hand(t1, dealer_final, paid1, free1, row)
+    if paid2 + free2 > 0.0: _settle_free_bet_hand(t2, dealer_final, paid2, free2, row)
+
+@njit(cache=True)
+def _accumulate_free_bet_rounds(shoe_counts: np.ndarray, seed: int, lo: int, hi: int, out: np.ndarray) -> None:
+    """Plays rounds [lo, hi) into out's outcome sums and squares, as simulator._accumulate_rounds."""
+    rng = np.zeros(1, dtype=np.uint64)
+    row = np.zeros(NUM_FREE_BET_KEYS, dtype=np.float64)
+    temp_shoe = make_scratch_shoe(shoe_counts)
+    undo_log = make_undo_log()
+    for i in range(lo, hi):
+        rng[0] = rng_stream_state(seed, i)
+        row[:] = 0.0
+        _simulate_free_bet_round(temp_shoe, undo_log, rng, row)
+        restore_scratch_shoe(temp_shoe, undo_log)
+        for k in range(NUM_FREE_BET_KEYS):
+            out[0, k] += row[k]
+            out[1, k] += row[k] * row[k]
+
+@njit(parallel=True)
+def simulate_free_bet_chunk(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int, block_rounds: int = BLOCK_ROUNDS
+) -> np.ndarray:
+    """
+    Free Bet counterpart of simulator.simulate_chunk: a (2, NUM_FREE_BET_KEYS)
+    array of outcome sums and sums of squares for rounds [start_round,
+    start_round + rounds), independent of how the range is partitioned.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial = np.zeros((max(n_blocks, 1), 2, NUM_FREE_BET_KEYS), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            lo = start_round + (rounds * b) // n_blocks
+            hi = start_round + (rounds * (b + 1)) // n_blocks
+            _accumulate_free_bet_rounds(shoe_counts, seed, lo, hi, partial[b])
+    return reduce_blocks(partial)
+
+# --- Exact dealer outcomes ---
+
+def rank_categories(shoe_counts: np.ndarray) -> np.ndarray:
+    """Collapses a 52-card shoe array to counts of A, 2-9 and ten-valued cards."""
+    by_rank = np.asarray(shoe_counts, dtype=np.int64).reshape(4, 13).sum(axis=0)
+    return np.append(by_rank[:9], by_rank[9:].sum())
+
+@njit(cache=True)
+def _dealer_draws(counts: np.ndarray, remaining: int, hard_total: int, aces: int, prob: float, out: np.ndarray) -> None:
+    """Adds every draw sequence from a dealer hand of at least two cards into out, drawing without replacement."""
+    total, _ = hand_state_total(hard_total, aces)
+    if total >= 17:
+        out[total - 17 if total <= 22 else DEALER_BUST] += prob
+        return
+    for c in range(NUM_CATEGORIES):
+        if counts[c] == 0: continue
+        p = prob * counts[c] / remaining
+        counts[c] -= 1
+        _dealer_draws(counts, remaining - 1, hard_total + c + 1, aces + (1 if c == 0 else 0), p, out)
+        counts[c] += 1
+
+@njit(cache=True)
+def dealer_distribution(category_counts: np.ndarray, up_category: int, peeked: bool = True) -> np.ndarray:
+    """
+    Exact probabilities of DEALER_OUTCOMES for an upcard category (0 for an
+    Ace, 9 for a ten) dealt from category_counts, which must not include the
+    upcard. With peeked the dealer is known not to hold a natural, so the
+    blackjack entry is 0 and the rest is conditioned on that. Stands on all 17s.
+    """
+    out = np.zeros(len(DEALER_OUTCOMES), dtype=np.float64)
+    counts = category_counts.astype(np.int64)
+    remaining = counts.sum()
+    if remaining == 0: return out
+    up_hard, up_aces = up_category + 1, 1 if up_category == 0 else 0
+    for c in range(NUM_CATEGORIES):
+        if counts[c] == 0: continue
+        p = counts[c] / remaining
+        hard_total, aces = up_hard + c + 1, up_aces + (1 if c == 0 else 0)
+        if hand_state_total(hard_total, aces)[0] == 21:
+            out[DEALER_BLACKJACK] += p
+            continue
+        counts[c] -= 1
+        _dealer_draws(counts, remaining - 1, hard_total, aces, p, out)
+        counts[c] += 1
+    if peeked and out[DEALER_BLACKJACK] > 0.0:
+        out[:DEALER_BLACKJACK] /= 1.0 - out[DEALER_BLACKJACK]
+        out[DEALER_BLACKJACK] = 0.0
+    return out
+
+def dealer_22_table(shoe_counts: np.ndarray, peeked: bool = True) -> dict[str, dict[str, float]]:
+    """dealer_distribution for every upcard of a shoe, keyed by upcard and outcome."""
+    categories = rank_categories(shoe_counts)
+    table = {}
+    for up, name in enumerate(("A", "2", "3", "4", "5", "6", "7", "8", "9", "10")):
+        if categories[up] == 0: continue
+        counts = categories.copy()
+        counts[up] -= 1
+        dist = dealer_distribution(counts, up, peeked)
+        table[name] = {key: float(dist[k]) for k, key in enumerate(DEALER_OUTCOMES)}
+    return table
+
+def simulate_free_bet(
+    decks: int = 6,
+    rounds: int = 1_000_000,
+    num_threads: int = 4,
+    seed: int | None = None,
+    shoe_counts: np.ndarray | None = None
+) -> dict:
+    """
+    Mean and standard error of every FREE_BET_KEYS column over `rounds`
+    rounds dealt from shoe_counts (a fresh shoe of `decks` decks by default),
+    with the exact probability of a dealer 22 for the same shoe.
+    """
+    if shoe_counts is None:
+        shoe_counts = simulator.FastSimulator(shoe.Shoe(decks=decks).get_remaining_cards()).shoe_counts
+    seed = random.getrandbits(63) if seed is None else seed
+
+    result = {"rounds": rounds, "seed": seed}
+    result.update(simulator.run_engine(simulate_free_bet_chunk, (shoe_counts, rounds, seed, 0),
+                                       rounds, FREE_BET_KEYS, num_threads))
+
+    categories = rank_categories(shoe_counts)
+    total_cards = categories.sum()
+    dealer_22 = 0.0
+    for up in range(NUM_CATEGORIES):
+        if categories[up] == 0: continue
+        counts = categories.copy()
+        counts[up] -= 1
+        dealer_22 += categories[up] / total_cards * dealer_distribution(counts, up, False)[DEALER_22]
+    result["dealer_22_probability"] = float(dealer_22)
+    return result
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Simulate Free Bet Blackjack.")
+    parser.add_argument("--decks", type=int, default=6)
+    parser.add_argument("--rounds", type=int, default=1_000_000)
+    parser.add_argument("--threads", type=int, default=4)
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--dealer-table", action="store_true", help="Also print the exact dealer outcomes per upcard.")
+    args = parser.parse_args(argv)
+
+    result = simulate_free_bet(args.decks, args.rounds, args.threads, args.seed)
+    if args.dealer_table:
+        result["dealer_outcomes"] = dealer_22_table(
+            simulator.FastSimulator(shoe.Shoe(decks=args.decks).get_remaining_cards()).shoe_counts)
+    print(json.dumps(result, indent=2))
+
+if __name__ == "__main__":
+    main()
@@ -6,12 +6,14 @@ for threading stability to prevent crashes between simulations.
 from __future__ import annotations
 import sys
 import os
+import copy
+import threading
 from PyQt6.QtWidgets import (
     QApplication, QMainWindow, QWidget, QPushButton, QLabel, QGridLayout,
     QVBoxLayout, QHBoxLayout, QGroupBox, QRadioButton, QTextEdit, QMessageBox,
-    QProgressBar, QButtonGroup, QInputDialog
+    QProgressBar, QButtonGroup, QInputDialog, QFileDialog
 )
-from PyQt6.QtCore import Qt, QThread, pyqtSignal, QObject
+from PyQt6.QtCore import Qt, QThread, pyqtSignal, QObject, QRunnable, QThreadPool
 from PyQt6.QtGui import QFont
 
 import counting
@@ -20,24 +22,103 @@ import simulator
 import strategy
 import bayesian_predictor
 import decision_advisor
+import exit_policy
+from tracing import TRACER
+
+SIM_ROUNDS = 250_000
+# Written by `python exit_policy.py`; consulted by the strategy advisor when present.
+EXIT_POLICY_PATH = "exit_policy.json"
 
 class SimulationWorker(QObject):
+    """
+    Runs the simulation in growing chunks, emitting the running estimate after
+    each one, and stops early when cancel() is called.
+    """
     finished = pyqtSignal(dict)
+    progress = pyqtSignal(dict)
+    cancelled = pyqtSignal()
     error = pyqtSignal(str)
 
     def __init__(self, shoe_dict: dict[str, int], num_threads: int):
         super().__init__()
         self.shoe_dict = shoe_dict
         self.num_threads = num_threads
+        self._cancel_event = threading.Event()
+
+    def cancel(self):
+        """Thread-safe; the worker stops before its next chunk."""
+        self._cancel_event.set()
+
+    def _emit_progress(self, accumulator: simulator.SimAccumulator):
+        self.progress.emit({
+            "rounds": accumulator.rounds, "total": SIM_ROUNDS,
+            "mean": accumulator.mean(), "std_error": accumulator.std_error(),
+        })
 
     def run(self):
         try:
-            sim = simulator.FastSimulator(self.shoe_dict)
-            results = sim.run(total_rounds=250_000, num_threads=8)
-            self.finished.emit(results)
+            with TRACER.stage("simulation"):
+                sim = simulator.FastSimulator(self.shoe_dict)
+                accumulator = sim.run_progressive(
+                    SIM_ROUNDS, num_threads=8, on_progress=self._emit_progress,
+                    should_stop=self._cancel_event.is_set, launch_lock=simulator.KERNEL_LAUNCH_LOCK)
+            if self._cancel_event.is_set():
+                TRACER.count("simulations_cancelled")
+                self.cancelled.emit()
+                return
+            TRACER.count("simulations_run")
+            self.finished.emit(accumulator.mean())
         except Exception as e:
             self.error.emit(f"A critical error occurred in the simulation engine:\n{e}")
 
+class AdvisorySignals(QObject):
+    finished = pyqtSignal(int, dict)
+    error = pyqtSignal(int, str)
+
+class AdvisoryTask(QRunnable):
+    """
+    Computes the dealer-total distribution and the betting recommendations off
+    the GUI thread for one snapshot of the shoe. Each task carries the
+    generation number it was requested for; it gives up between stages as soon
+    as a newer card has made it stale, and the window ignores stale results.
+    """
+    def __init__(self, generation: int, is_stale, shoe_snapshot: shoe.Shoe, counters: dict,
+                 sim_results: dict[str, float], dealer_upcard: str | None,
+                 advisor: strategy.StrategyAdvisor, footer: str = ""):
+        super().__init__()
+        self.generation = generation
+        self.is_stale = is_stale
+        self.shoe_snapshot = shoe_snapshot
+        self.counters = counters
+        self.sim_results = sim_results
+        self.dealer_upcard = dealer_upcard
+        self.advisor = advisor
+        self.footer = footer
+        self.signals = AdvisorySignals()
+
+    def run(self):
+        try:
+            if self.is_stale(): return self._cancel()
+            bayes_totals = None
+            if self.dealer_upcard:
+                with TRACER.stage("dealer_total_probabilities"):
+                    bayes_totals = bayesian_predictor.dealer_total_probabilities(
+                        self.dealer_upcard, self.shoe_snapshot.get_remaining_cards(), simulations=5000)
+
+            if self.is_stale(): return self._cancel()
+            # The side-bet kernel must not overlap a simulation chunk on the worker thread.
+            with TRACER.stage("generate_recommendations"), simulator.KERNEL_LAUNCH_LOCK:
+                recommendations = self.advisor.generate_recommendations(
+                    self.shoe_snapshot, self.counters, self.sim_results, bayes_totals)
+
+            if self.is_stale(): return self._cancel()
+            self.signals.finished.emit(self.generation, {"recommendations": recommendations, "footer": self.footer})
+        except Exception as e:
+            self.signals.error.emit(self.generation, str(e))
+
+    def _cancel(self):
+        TRACER.count("advisory_cancelled")
+
 class MainWindow(QMainWindow):
     def __init__(self):
         super().__init__()
@@ -50,10 +131,23 @@ class MainWindow(QMainWindow):
             "Wong Halves": counting.WongHalves(), "Omega II": counting.Omega2Count(),
         }
         self.strategy_advisor = strategy.StrategyAdvisor()
+        if os.path.exists(EXIT_POLICY_PATH):
+            try:
+                self.strategy_advisor.config['exit_policy'] = exit_policy.ExitPolicy.load(EXIT_POLICY_PATH)
+            except (OSError, ValueError, KeyError) as e:
+                QMessageBox.warning(self, "Exit Policy Error", f"Ignoring unreadable exit policy {EXIT_POLICY_PATH}: {e}")
         
         self.simulation_thread: QThread | None = None
         self.simulation_worker: SimulationWorker | None = None
         self.dealer_hole_card_placeholder: str | None = None
+
+        # One advisory worker at a time: queued stale tasks exit immediately.
+        # Advisory and simulation kernels share simulator.KERNEL_LAUNCH_LOCK, so
+        # no two parallel kernels run at once (the simulation yields between chunks).
+        self.advisory_pool = QThreadPool()
+        self.advisory_pool.setMaxThreadCount(1)
+        self.advisory_generation: int = 0
+        self._pending_footer: str = ""
         
         self._init_round_state()
         self._init_ui()
@@ -128,9 +222,14 @@ class MainWindow(QMainWindow):
         self.reset_button = QPushButton("Reset Shoe")
         self.reset_button.clicked.connect(self._reset_shoe)
         
+        self.timing_button = QPushButton("Pipeline Timing")
+        self.timing_button.setCheckable(True)
+        self.timing_button.toggled.connect(self._toggle_timing_panel)
+        
         control_layout.addWidget(self.run_sim_button, 0, 0)
         control_layout.addWidget(self.undo_button, 0, 1)
         control_layout.addWidget(self.reset_button, 1, 0, 1, 2)
+        control_layout.addWidget(self.timing_button, 2, 0, 1, 2)
         layout.addLayout(control_layout)
         return layout
 
@@ -188,8 +287,46 @@ class MainWindow(QMainWindow):
         sim_strat_layout.addWidget(self.sim_output)
         sim_strat_group.setLayout(sim_strat_layout)
         layout.addWidget(sim_strat_group)
+
+        self.timing_group = QGroupBox("Pipeline Timing (debug)")
+        timing_layout = QVBoxLayout()
+        self.timing_output = QTextEdit()
+        self.timing_output.setReadOnly(True)
+        self.timing_output.setFont(QFont("Courier New", 9))
+        timing_reset_button = QPushButton("Reset Timing")
+        timing_reset_button.clicked.connect(self._reset_timing)
+        timing_save_button = QPushButton("Save Timing...")
+        timing_save_button.clicked.connect(self._save_timing)
+        timing_buttons = QHBoxLayout()
+        timing_buttons.addWidget(timing_reset_button)
+        timing_buttons.addWidget(timing_save_button)
+        timing_layout.addWidget(self.timing_output)
+        timing_layout.addLayout(timing_buttons)
+        self.timing_group.setLayout(timing_layout)
+        self.timing_group.setVisible(False)
+        layout.addWidget(self.timing_group)
         return layout
 
+    def _toggle_timing_panel(self, checked: bool):
+        self.timing_group.setVisible(checked)
+        self._refresh_timing_panel()
+
+    def _reset_timing(self):
+        TRACER.reset()
+        self._refresh_timing_panel()
+
+    def _save_timing(self):
+        path, _ = QFileDialog.getSaveFileName(self, "Save Pipeline Timing", "timing.json", "JSON (*.json)")
+        if not path: return
+        try:
+            TRACER.dump(path)
+        except OSError as e:
+            QMessageBox.warning(self, "Timing Error", f"Could not save timing data: {e}")
+
+    def _refresh_timing_panel(self):
+        if self.timing_group.isVisible():
+            self.timing_output.setText(TRACER.format_table())
+
     def _on_radio_toggled(self, button, checked):
         if not checked: return
         mode_map = {self.radio_player: "player", self.radio_dealer: "dealer", self.radio_burned: "burned"}
@@ -212,6 +349,7 @@ class MainWindow(QMainWindow):
                 QMessageBox.warning(self, "Shoe Error", str(e))
 
     def _add_card_to_game(self, card_code: str, mode: str):
+        self._cancel_running_simulation()
         try:
             if card_code != self.dealer_hole_card_placeholder:
                 self.shoe.remove_card(card_code)
@@ -223,6 +361,7 @@ class MainWindow(QMainWindow):
             
             self.action_history.append((card_code, mode))
             self.round_card_count += 1
+            TRACER.count("cards_entered")
         except (ValueError, KeyError) as e:
             QMessageBox.warning(self, "Card Error", str(e))
             return
@@ -230,6 +369,7 @@ class MainWindow(QMainWindow):
 
     def _undo_last_card(self):
         if not self.action_history: return
+        self._cancel_running_simulation()
         last_card, last_mode = self.action_history.pop()
         
         try:
@@ -258,6 +398,7 @@ class MainWindow(QMainWindow):
         self.run_sim_button.setEnabled(False)
         self.run_sim_button.setText("Simulating...")
         self.sim_output.setText("Running high-performance simulation...")
+        self.advisory_generation += 1  # drop any advisory still queued for the old shoe
 
         num_cores_to_use = max(1, os.cpu_count() - 1)
         
@@ -267,10 +408,13 @@ class MainWindow(QMainWindow):
 
         self.simulation_thread.started.connect(self.simulation_worker.run)
         self.simulation_worker.finished.connect(self._on_simulation_finished)
+        self.simulation_worker.progress.connect(self._on_simulation_progress)
+        self.simulation_worker.cancelled.connect(self._on_simulation_cancelled)
         self.simulation_worker.error.connect(self._on_simulation_error)
         
-        self.simulation_worker.finished.connect(self.simulation_thread.quit)
-        self.simulation_worker.finished.connect(self.simulation_worker.deleteLater)
+        for done_signal in (self.simulation_worker.finished, self.simulation_worker.cancelled, self.simulation_worker.error):
+            done_signal.connect(self.simulation_thread.quit)
+            done_signal.connect(self.simulation_worker.deleteLater)
         self.simulation_thread.finished.connect(self.simulation_thread.deleteLater)
         # BUG FIX: Connect the finished signal to the cleanup slot.
         self.simulation_thread.finished.connect(self._cleanup_thread_references)
@@ -286,8 +430,29 @@ class MainWindow(QMainWindow):
         
         self._init_round_state() 
         self.last_sim_results = results
+        self._pending_footer = "\n\n--- End of Round ---\nReady for next hand."
         self.update_displays()
-        self.sim_output.append("\n\n--- End of Round ---\nReady for next hand.")
+
+    def _on_simulation_progress(self, snapshot: dict):
+        rounds, total = snapshot["rounds"], snapshot["total"]
+        self.run_sim_button.setText(f"Simulating... {100 * rounds // total}%")
+        labels = (("main_ev", "Main Bet"), ("bust_ev", "Dealer Bust"), ("21+3_ev", "21+3"),
+                  ("perfect_pairs_ev", "Perfect Pairs"), ("hot3_ev", "Hot 3"))
+        lines = [f"Simulating: {rounds:,} / {total:,} rounds", "EV (95% confidence interval):"]
+        for key, label in labels:
+            if key not in snapshot["mean"]: continue
+            half_width = 1.96 * snapshot["std_error"].get(key, 0.0)
+            lines.append(f"  {label:<14} {snapshot['mean'][key]:+.2%}  \u00b1 {half_width:.2%}")
+        self.sim_output.setText("\n".join(lines))
+
+    def _on_simulation_cancelled(self):
+        self.run_sim_button.setEnabled(True)
+        self.run_sim_button.setText("Run Sim & End Round")
+        self.sim_output.setText("Simulation cancelled: the shoe changed. Run it again for the new cards.")
+
+    def _cancel_running_simulation(self):
+        if self.simulation_worker and self.simulation_thread and self.simulation_thread.isRunning():
+            self.simulation_worker.cancel()
 
     def _prompt_for_hole_card(self):
         if not self.dealer_hole_card_placeholder: return
@@ -328,6 +493,11 @@ class MainWindow(QMainWindow):
         self.update_displays()
 
     def update_displays(self):
+        with TRACER.stage("update_displays"):
+            self._update_displays()
+        self._refresh_timing_panel()
+
+    def _update_displays(self):
         display_text = ""
         for role, cards in self.selected_cards.items():
             display_text += f"{role.title():<7}: {' '.join(cards)}\n"
@@ -353,7 +523,8 @@ class MainWindow(QMainWindow):
             
             if len(player_hand) >= 2 and dealer_upcard:
                 hilo_tc = self.counters["Hi-Lo"].true_count(decks_remaining)
-                advice = decision_advisor.recommend_action(player_hand, dealer_upcard, hilo_tc)
+                with TRACER.stage("decision_advisor"):
+                    advice = decision_advisor.recommend_action(player_hand, dealer_upcard, hilo_tc)
                 self.advisor_output.setText(advice)
             else:
                 self.advisor_output.setText("Enter Player (2) and Dealer (1) cards for advice.")
@@ -361,23 +532,44 @@ class MainWindow(QMainWindow):
             self.advisor_output.setText(f"Advisor Error: {e}")
 
         if self.last_sim_results:
-            try:
-                dealer_upcard = self.selected_cards["dealer"][0] if self.selected_cards["dealer"] else None
-                bayes_totals = None
-                if dealer_upcard:
-                    bayes_totals = bayesian_predictor.dealer_total_probabilities(
-                        dealer_upcard, self.shoe.get_remaining_cards(), simulations=5000)
-                
-                recommendations = self.strategy_advisor.generate_recommendations(
-                    self.shoe, self.counters, self.last_sim_results, bayes_totals)
-                self.sim_output.setText("\n".join(recommendations))
-            except Exception as e:
-                self.sim_output.setText(f"Strategy Display Error: {e}")
+            self._request_advisory()
         elif not self.run_sim_button.isEnabled():
             pass
         else:
             self.sim_output.setText("Enter cards and run simulation to get betting advice.")
 
+    def _request_advisory(self):
+        """Queues the advisory computation for the current shoe, superseding any pending one."""
+        self.advisory_generation += 1
+        generation = self.advisory_generation
+        dealer_upcard = self.selected_cards["dealer"][0] if self.selected_cards["dealer"] else None
+        task = AdvisoryTask(
+            generation, lambda: generation != self.advisory_generation,
+            self.shoe.copy(), copy.deepcopy(self.counters), dict(self.last_sim_results),
+            dealer_upcard, self.strategy_advisor, self._pending_footer)
+        self._pending_footer = ""
+        task.signals.finished.connect(self._on_advisory_finished)
+        task.signals.error.connect(self._on_advisory_error)
+        self.advisory_pool.start(task)
+
+    def _on_advisory_finished(self, generation: int, payload: dict):
+        if generation != self.advisory_generation: return
+        self.sim_output.setText("\n".join(payload["recommendations"]) + payload["footer"])
+        self._refresh_timing_panel()
+
+    def _on_advisory_error(self, generation: int, error_message: str):
+        if generation != self.advisory_generation: return
+        self.sim_output.setText(f"Strategy Display Error: {error_message}")
+
+    def closeEvent(self, event):
+        self._cancel_running_simulation()
+        if self.simulation_thread: self.simulation_thread.wait()
+        self.advisory_generation += 1
+        self.advisory_pool.clear()
+        self.advisory_pool.waitForDone()
+        super().closeEvent(event)
+
+
 if __name__ == "__main__":
     app = QApplication(sys.argv)
     window = MainWindow()
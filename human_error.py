@@ -0,0 +1,269 @@
+"""
+Cost of human error for a Hi-Lo counter. Whole shoes are dealt to the cut
+card while the player counts, bets by a ramp on the true count and applies the
+index plays of decision_advisor.STRATEGY_CONFIG. The same shoes are then
+replayed under error models:
+
+  miscount   each card seen is tagged wrong (running count off by one, either
+             way) with a given probability
+  half_deck  the decks remaining are estimated to the nearest half deck
+  misplay    an index decision comes out the wrong way (deviating when the
+             count says not to, or the reverse) with a given probability,
+             overall or per index play
+
+Index plays cover hard two-card hands only, as in indices.generate_index;
+soft hands always get the simulator's own play. An index play's alternative
+is to hit (to stand for a Hit index), the same alternative generate_index
+measures against, so every play has a cost even where the simulator's own
+strategy already agrees with the deviation (it stands on 13 vs 2 and 12 vs 4,
+and doubles 10 vs A).
+
+Every variant replays the baseline's random streams (common random numbers):
+round r of shoe i draws from the same stream in every variant, and errors draw
+from a separate stream. The difference to the error-free baseline is therefore
+measured per shoe, with a far smaller standard error than two independent
+runs would give.
+
+    python human_error.py --shoes 200000 --miscount 0.01 --misplay 0.1
+"""
+from __future__ import annotations
+import argparse
+import json
+import math
+import random
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+import decision_advisor
+import indices
+import shoe
+import simulator
+import whole_shoe
+from numba_utils import (
+    SHOE_TOTAL, HILO_TAGS, add_card_to_hand, hand_state_total, make_scratch_shoe, make_undo_log,
+    draw_scratch_card_rng, restore_scratch_shoe, rng_stream_state, rng_uniform,
+)
+from indices import ACTION_DOUBLE, ACTION_HIT, ACTION_STAND
+from simulator import num_blocks, _play_dealer_hand, _play_single_hand, _play_spot, _resolve_outcome, _should_split
+from whole_shoe import PATHS_PER_BLOCK
+
+# Columns of a variant row and of an index-table row.
+VAR_MISCOUNT, VAR_HALF_DECK, VAR_MISPLAY = 0, 1, 2
+IDX_TOTAL, IDX_DEALER, IDX_ACTION, IDX_THRESHOLD, IDX_BELOW, IDX_MISPLAY, IDX_ALTERNATIVE = range(7)
+
+DEFAULT_BET_SPREAD = {0: 1.0, 1: 2.0, 2: 4.0, 3: 6.0, 4: 8.0}
+
+def index_table(misplay_prob: float | dict[str, float] = 0.0, config: dict | None = None) -> np.ndarray:
+    """
+    The strategy config's index plays as rows of (player total, dealer rank
+    index with 9 for any ten, action code, threshold, 1.0 if the play applies
+    below the threshold, misplay probability, action code when the play does
+    not apply). misplay_prob is one probability for every play or a dict keyed
+    like the config ("16-vs-10").
+    """
+    cfg = config or decision_advisor.STRATEGY_CONFIG
+    rows = []
+    for key, play in cfg["index_plays"].items():
+        total, dealer = indices.parse_index_key(key)
+        p = misplay_prob.get(key, 0.0) if isinstance(misplay_prob, dict) else misplay_prob
+        action = indices.ACTION_CODES[play["action"]]
+        rows.append((total, indices.DEALER_RANKS[dealer], action, play["threshold"],
+                     1.0 if play.get("condition", "above") == "below" else 0.0, p,
+                     ACTION_STAND if action == ACTION_HIT else ACTION_HIT))
+    return np.array(rows, dtype=np.float64).reshape(-1, 7)
+
+@njit(cache=True)
+def _perceived_true_count(running_count: float, cards_left: int, half_deck: bool) -> float:
+    decks = cards_left / 52.0
+    if half_deck: decks = max(0.5, math.floor(cards_left / 26.0 + 0.5) / 2.0)
+    return running_count / decks if decks > 0 else 0.0
+
+@njit(cache=True)
+def _play_counted_round(
+    scratch: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, err_rng: np.ndarray,
+    true_count: float, index_plays: np.ndarray, misplay: bool
+) -> float:
+    """
+    One heads-up main-bet round for one unit with index plays at the given
+    (perceived) true count. An index decides the first action of an unsplit
+    hard two-card hand (the table's totals are hard totals): its action when it applies, its alternative otherwise; with
+    misplay set the decision is flipped with the play's misplay probability.
+    Returns 0.0 if the shoe ran dry.
+    """
+    p1_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+    p2_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+    d_hole_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+    if -1 in (p1_idx, p2_idx, d1_idx, d_hole_idx): return 0.0
+
+    p1_rank, p2_rank, d_rank = p1_idx % 13, p2_idx % 13, d1_idx % 13
+    p_hard, p_aces = add_card_to_hand(0, 0, p1_rank)
+    p_hard, p_aces = add_card_to_hand(p_hard, p_aces, p2_rank)
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    player_total, player_soft = hand_state_total(p_hard, p_aces)
+    dealer_total = hand_state_total(d_hard, d_aces)[0]
+    if player_total == 21: return 1.5 if dealer_total != 21 else 0.0
+    if dealer_total == 21: return -1.0
+
+    action = -1
+    if not player_soft and not (p1_rank == p2_rank and _should_split(p1_rank, d_rank)):
+        for k in range(index_plays.shape[0]):
+            if index_plays[k, IDX_TOTAL] != player_total or index_plays[k, IDX_DEALER] != min(d_rank, 9): continue
+            threshold = index_plays[k, IDX_THRESHOLD]
+            applies = true_count < threshold if index_plays[k, IDX_BELOW] > 0.0 else true_count >= threshold
+            if misplay and rng_uniform(err_rng) < index_plays[k, IDX_MISPLAY]: applies = not applies
+            action = int(index_plays[k, IDX_ACTION if applies else IDX_ALTERNATIVE])
+            break
+
+    t2, m2 = 0, 0.0
+    if action == ACTION_STAND:
+        t1, m1 = player_total, 1.0
+    elif action == ACTION_DOUBLE:
+        card_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+        if card_idx != -1: p_hard, p_aces = add_card_to_hand(p_hard, p_aces, card_idx % 13)
+        t1, m1 = hand_state_total(p_hard, p_aces)[0], 2.0
+    elif action == ACTION_HIT:
+        card_idx = draw_scratch_card_rng(scratch, undo_log, rng)
+        if card_idx == -1: return 0.0
+        p_hard, p_aces = add_card_to_hand(p_hard, p_aces, card_idx % 13)
+        t1, m1 = _play_single_hand(p_hard, p_aces, 3, scratch, undo_log, d_rank, rng, None)
+    else:
+        t1, m1, t2, m2 = _play_spot(p1_rank, p2_rank, d_rank, scratch, undo_log, rng, None)
+        if m1 == 0.0: return 0.0
+
+    dealer_final, _ = _play_dealer_hand(d_hard, d_aces, 2, scratch, undo_log, rng, None)
+    outcome = _resolve_outcome(t1, dealer_final, m1)
+    if m2 > 0.0: outcome += _resolve_outcome(t2, dealer_final, m2)
+    return outcome
+
+@njit(parallel=True)
+def simulate_errors(
+    shoe_counts: np.ndarray, n_shoes: int, seed: int, error_seed: int, min_cards: int,
+    variants: np.ndarray, tc_min: int, bet_units: np.ndarray, index_plays: np.ndarray
+) -> tuple[np.ndarray, np.ndarray]:
+    """
+    Deals n_shoes full shoes to the cut card once per error variant (rows of
+    (miscount probability, half-deck flag, misplay flag)). The count is taken
+    at the start of each round and updated with every card of the round once
+    it is over. Returns (shoes, variants) arrays of units won and rounds played.
+    """
+    n_variants = variants.shape[0]
+    won = np.zeros((n_shoes, n_variants))
+    played = np.zeros((n_shoes, n_variants), dtype=np.int64)
+    capacity = int(np.sum(shoe_counts))
+    cut = max(min_cards, 1)
+    top = bet_units.shape[0] - 1
+    n_blocks = num_blocks(n_shoes, PATHS_PER_BLOCK)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            rng = np.zeros(1, dtype=np.uint64)
+            err_rng = np.zeros(1, dtype=np.uint64)
+            scratch = make_scratch_shoe(shoe_counts)
+            undo_log = make_undo_log(capacity)
+            for i in range((n_shoes * b) // n_blocks, (n_shoes * (b + 1)) // n_blocks):
+                for v in range(n_variants):
+                    miscount = variants[v, VAR_MISCOUNT]
+                    half_deck = variants[v, VAR_HALF_DECK] > 0.0
+                    misplay = variants[v, VAR_MISPLAY] > 0.0
+                    err_rng[0] = rng_stream_state(error_seed, i)
+                    running_count = 0.0
+                    r = 0
+                    while scratch[SHOE_TOTAL] >= cut:
+                        rng[0] = rng_stream_state(seed, i * capacity + r)
+                        tc = _perceived_true_count(running_count, scratch[SHOE_TOTAL], half_deck)
+                        bet = bet_units[min(max(int(math.floor(tc)) - tc_min, 0), top)]
+                        first = undo_log[0] + 1
+                        won[i, v] += bet * _play_counted_round(scratch, undo_log, rng, err_rng, tc, index_plays, misplay)
+                        played[i, v] += 1
+                        for j in range(first, undo_log[0] + 1):
+                            running_count += HILO_TAGS[undo_log[j] % 13]
+                            if miscount > 0.0 and rng_uniform(err_rng) < miscount:
+                                running_count += 1.0 if rng_uniform(err_rng) < 0.5 else -1.0
+                        r += 1
+                    restore_scratch_shoe(scratch, undo_log)
+    return won, played
+
+def error_variants(miscount_prob: float, half_deck: bool, misplay_prob: float | dict[str, float]) -> dict[str, tuple]:
+    """Baseline, each enabled error on its own, and all of them together when more than one is enabled."""
+    misplay = bool(misplay_prob) and (not isinstance(misplay_prob, dict) or any(misplay_prob.values()))
+    variants = {"baseline": (0.0, 0.0, 0.0)}
+    if miscount_prob > 0: variants["miscount"] = (miscount_prob, 0.0, 0.0)
+    if half_deck: variants["half_deck"] = (0.0, 1.0, 0.0)
+    if misplay: variants["misplay"] = (0.0, 0.0, 1.0)
+    if len(variants) > 2: variants["combined"] = (miscount_prob, 1.0 if half_deck else 0.0, 1.0 if misplay else 0.0)
+    return variants
+
+def _ratio_residuals(won: np.ndarray, played: np.ndarray) -> tuple[float, np.ndarray]:
+    """Win rate per round and the per-shoe linearized residuals of that ratio estimate."""
+    rate = won.sum() / played.sum()
+    return float(rate), (won - rate * played) / played.mean()
+
+def error_costs(
+    decks: int = 8,
+    penetration: float = 0.75,
+    n_shoes: int = 100_000,
+    miscount_prob: float = 0.01,
+    half_deck: bool = True,
+    misplay_prob: float | dict[str, float] = 0.1,
+    bet_spread: dict[int, float] | None = None,
+    tc_min: int = -6,
+    tc_max: int = 6,
+    seed: int | None = None
+) -> dict:
+    """
+    Win rate per round of the error-free counter and, for every error
+    variant, the win rate, its cost against the baseline per round and per 100
+    rounds with the paired (common random numbers) standard error, and the
+    standard error two independent runs would have had.
+    """
+    fresh = shoe.Shoe(decks=decks)
+    shoe_counts = simulator.FastSimulator(fresh.get_remaining_cards()).shoe_counts
+    min_cards = int(round(fresh.initial_card_count * (1.0 - penetration)))
+    bet_units = whole_shoe.bet_ramp(tc_min, tc_max, bet_spread or DEFAULT_BET_SPREAD)
+    seed = random.getrandbits(63) if seed is None else seed
+    error_seed = random.Random(seed).getrandbits(63)
+
+    variants = error_variants(miscount_prob, half_deck, misplay_prob)
+    won, played = simulate_errors(shoe_counts, n_shoes, seed, error_seed, min_cards,
+                                  np.array(list(variants.values()), dtype=np.float64),
+                                  tc_min, bet_units, index_table(misplay_prob))
+
+    base_rate, base_resid = _ratio_residuals(won[:, 0], played[:, 0])
+    result = {"shoes": n_shoes, "seed": seed, "rounds": int(played[:, 0].sum()), "baseline_win_rate": base_rate,
+              "baseline_std_error": float(base_resid.std(ddof=1) / math.sqrt(n_shoes)), "variants": {}}
+    for v, (name, params) in enumerate(variants.items()):
+        if v == 0: continue
+        rate, resid = _ratio_residuals(won[:, v], played[:, v])
+        paired_se = float((resid - base_resid).std(ddof=1) / math.sqrt(n_shoes))
+        independent_se = float(math.sqrt((resid.var(ddof=1) + base_resid.var(ddof=1)) / n_shoes))
+        result["variants"][name] = {
+            "miscount_prob": params[VAR_MISCOUNT], "half_deck": bool(params[VAR_HALF_DECK]), "misplay": bool(params[VAR_MISPLAY]),
+            "win_rate": rate, "cost_per_round": base_rate - rate, "cost_per_100_rounds": 100.0 * (base_rate - rate),
+            "cost_std_error": paired_se, "independent_std_error": independent_se,
+            "share_of_win_rate": (base_rate - rate) / base_rate if base_rate > 0 else None,
+        }
+    return result
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Measure the win-rate cost of counting and playing errors.")
+    parser.add_argument("--decks", type=int, default=8)
+    parser.add_argument("--penetration", type=float, default=0.75)
+    parser.add_argument("--shoes", type=int, default=100_000)
+    parser.add_argument("--miscount", type=float, default=0.01, help="Probability of mis-tagging each card.")
+    parser.add_argument("--no-half-deck", action="store_true", help="Skip the half-deck estimation variant.")
+    parser.add_argument("--misplay", default="0.1", help='Misplay probability, or JSON per play, e.g. \'{"16-vs-10": 0.2}\'.')
+    parser.add_argument("--spread", help='Bet spread as JSON, e.g. \'{"0": 1, "2": 4, "4": 8}\'.')
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args(argv)
+
+    misplay = json.loads(args.misplay)
+    if not isinstance(misplay, dict): misplay = float(misplay)
+    spread = {int(k): float(v) for k, v in json.loads(args.spread).items()} if args.spread else None
+    print(json.dumps(error_costs(args.decks, args.penetration, args.shoes, args.miscount, not args.no_half_deck,
+                                 misplay, spread, seed=args.seed), indent=2))
+
+if __name__ == "__main__":
+    main()
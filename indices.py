@@ -0,0 +1,159 @@
+"""
+Generates Hi-Lo index numbers for the strategy deviations listed in
+decision_advisor.STRATEGY_CONFIG by simulation. For each true count in a
+range, a shoe with that count is built, the deviation and its basic-strategy
+alternative are played from identical random streams (common random numbers),
+and the index is the lowest true count at which the deviation is at least as
+good as the alternative.
+"""
+from __future__ import annotations
+import random
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+from numba_utils import (
+    add_card_to_hand, hand_state_total, make_scratch_shoe, make_undo_log,
+    draw_scratch_card_rng, restore_scratch_shoe, rng_stream_state,
+)
+from simulator import BLOCK_ROUNDS, num_blocks, _play_single_hand, _play_dealer_hand, _resolve_outcome
+import decision_advisor
+
+ACTION_STAND, ACTION_HIT, ACTION_DOUBLE = 0, 1, 2
+ACTION_CODES = {"Stand": ACTION_STAND, "Hit": ACTION_HIT, "Double": ACTION_DOUBLE}
+
+# Representative two-card hands for each hard total used by the index plays.
+REPRESENTATIVE_HANDS = {16: (9, 5), 15: (9, 4), 14: (9, 3), 13: (9, 2), 12: (9, 1), 11: (5, 4), 10: (5, 3), 9: (4, 3)}
+DEALER_RANKS = {"A": 0, "2": 1, "3": 2, "4": 3, "5": 4, "6": 5, "7": 6, "8": 7, "9": 8, "10": 9}
+
+HILO_LOW_RANKS = (1, 2, 3, 4, 5)        # 2-6
+HILO_NEUTRAL_RANKS = (6, 7, 8)          # 7-9
+HILO_HIGH_RANKS = (0, 9, 10, 11, 12)    # A, 10-K
+
+def shoe_at_true_count(decks: int, penetration: float, true_count: float) -> np.ndarray:
+    """
+    Builds a 52-element shoe-count array with `penetration` of the cards dealt
+    and a Hi-Lo running count of true_count * decks_remaining, with each count
+    group spread as evenly as possible across its ranks and suits.
+    """
+    remaining = int(round(52 * decks * (1.0 - penetration)))
+    running_count = true_count * remaining / 52.0
+    low = int(round(remaining * 20 / 52 - running_count / 2))
+    high = int(round(remaining * 20 / 52 + running_count / 2))
+    low, high = max(0, min(low, 20 * decks)), max(0, min(high, 20 * decks))
+    neutral = max(0, min(remaining - low - high, 12 * decks))
+
+    shoe_counts = np.zeros(52, dtype=np.int32)
+    for group_total, ranks in ((low, HILO_LOW_RANKS), (neutral, HILO_NEUTRAL_RANKS), (high, HILO_HIGH_RANKS)):
+        slots = [suit * 13 + rank for rank in ranks for suit in range(4)]
+        for i, idx in enumerate(slots):
+            shoe_counts[idx] = group_total // len(slots) + (1 if i < group_total % len(slots) else 0)
+    return shoe_counts
+
+def _remove_rank(shoe_counts: np.ndarray, rank: int) -> None:
+    """Removes one card of the given rank (from the fullest suit) in place."""
+    idx = max((suit * 13 + rank for suit in range(4)), key=lambda i: shoe_counts[i])
+    if shoe_counts[idx] == 0:
+        raise ValueError(f"No card of rank index {rank} left in the shoe.")
+    shoe_counts[idx] -= 1
+
+@njit(parallel=True)
+def evaluate_play(
+    shoe_counts: np.ndarray, p1_rank: int, p2_rank: int, dealer_up_rank: int,
+    action: int, rounds: int, seed: int
+) -> np.ndarray:
+    """
+    Plays a fixed player hand against a fixed dealer upcard, taking `action`
+    on the first decision and following the simulator's strategy afterwards.
+    The three cards must already be removed from shoe_counts. Returns
+    [sum of outcomes, sum of squared outcomes].
+    """
+    n_blocks = num_blocks(rounds, BLOCK_ROUNDS)
+    partial = np.zeros((max(n_blocks, 1), 2), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            rng = np.zeros(1, dtype=np.uint64)
+            temp_shoe = make_scratch_shoe(shoe_counts)
+            undo_log = make_undo_log()
+            for i in range((rounds * b) // n_blocks, (rounds * (b + 1)) // n_blocks):
+                rng[0] = rng_stream_state(seed, i)
+                restore_scratch_shoe(temp_shoe, undo_log)
+                hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+                if hole_idx == -1: continue
+                d_hard, d_aces = add_card_to_hand(0, 0, dealer_up_rank)
+                d_hard, d_aces = add_card_to_hand(d_hard, d_aces, hole_idx % 13)
+                if hand_state_total(d_hard, d_aces)[0] == 21:
+                    partial[b, 0] -= 1.0
+                    partial[b, 1] += 1.0
+                    continue
+
+                p_hard, p_aces = add_card_to_hand(0, 0, p1_rank)
+                p_hard, p_aces = add_card_to_hand(p_hard, p_aces, p2_rank)
+                multiplier = 1.0
+                if action == ACTION_STAND:
+                    player_total = hand_state_total(p_hard, p_aces)[0]
+                else:
+                    n_cards = 2
+                    card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+                    if card_idx != -1:
+                        p_hard, p_aces = add_card_to_hand(p_hard, p_aces, card_idx % 13)
+                        n_cards = 3
+                    if action == ACTION_DOUBLE:
+                        player_total = hand_state_total(p_hard, p_aces)[0]
+                        multiplier = 2.0
+                    else:
+                        player_total, multiplier = _play_single_hand(
+                            p_hard, p_aces, n_cards, temp_shoe, undo_log, dealer_up_rank, rng, None)
+
+                dealer_total, _ = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+                outcome = _resolve_outcome(player_total, dealer_total, multiplier)
+                partial[b, 0] += outcome
+                partial[b, 1] += outcome * outcome
+
+    totals = np.zeros(2, dtype=np.float64)
+    for b in range(partial.shape[0]):
+        totals[0] += partial[b, 0]
+        totals[1] += partial[b, 1]
+    return totals
+
+def parse_index_key(key: str) -> tuple[int, str]:
+    """Splits an index-play key such as '16-vs-10' into (player_total, dealer_rank)."""
+    total, dealer = key.split("-vs-")
+    return int(total), dealer
+
+def generate_index(
+    key: str,
+    action: str,
+    decks: int = 8,
+    penetration: float = 0.5,
+    tc_range: range = range(-10, 11),
+    rounds: int = 200_000,
+    seed: int | None = None
+) -> dict:
+    """
+    Finds the index for playing `action` (instead of Hit) with the hand
+    described by `key`. Returns the index (None if the deviation never pays
+    in tc_range) and the EV gain of the deviation at every true count.
+    """
+    total, dealer = parse_index_key(key)
+    if total not in REPRESENTATIVE_HANDS or dealer not in DEALER_RANKS:
+        raise ValueError(f"Unsupported index play '{key}'.")
+    p1, p2 = REPRESENTATIVE_HANDS[total]
+    d_up = DEALER_RANKS[dealer]
+    seed = random.getrandbits(63) if seed is None else seed
+
+    gains: dict[int, float] = {}
+    for tc in tc_range:
+        shoe_counts = shoe_at_true_count(decks, penetration, tc)
+        for rank in (p1, p2, d_up): _remove_rank(shoe_counts, rank)
+        deviation = evaluate_play(shoe_counts, p1, p2, d_up, ACTION_CODES[action], rounds, seed)
+        alternative = evaluate_play(shoe_counts, p1, p2, d_up, ACTION_HIT, rounds, seed)
+        gains[tc] = float((deviation[0] - alternative[0]) / rounds)
+
+    index = next((tc for tc in tc_range if gains[tc] >= 0.0), None)
+    return {"play": key, "action": action, "index": index, "gain_by_tc": gains}
+
+def generate_indices(config: dict | None = None, **kwargs) -> list[dict]:
+    """Generates an index for every entry of the strategy config's index_plays."""
+    cfg = config or decision_advisor.STRATEGY_CONFIG
+    return [generate_index(key, play["action"], **kwargs) for key, play in cfg["index_plays"].items()]
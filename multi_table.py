@@ -0,0 +1,298 @@
+"""
+Back-counting (wonging) and team play across several tables. M tables are
+dealt side by side with the whole-shoe engine, one round per table per tick,
+all in a single kernel launch that is parallel over tables. A back-counter
+watches every table without playing, takes a seat at the table with the
+highest true count once it reaches the entry count, bets there according to a
+bet ramp, and gets up as soon as that table's count drops below the exit
+count or the shoe ends.
+
+In team play a spotter sits at every table betting the flat minimum and
+signals the count; the big player moves between tables by the same entry and
+exit rule, playing a second spot at the signalled table.
+
+    python multi_table.py --tables 4 --entry 2 --exit 0 --hours 2
+    python multi_table.py --team --tables 4 --entry 2 --spread '{"2": 10, "4": 20}'
+"""
+from __future__ import annotations
+import argparse
+import json
+import math
+import random
+from typing import Sequence
+
+import numpy as np
+from numba import njit, prange
+
+import shoe
+import simulator
+import strategy
+import whole_shoe
+
+# Tables dealt per deal_tables launch are capped so the recorded (tables, ticks)
+# arrays stay around this many rounds.
+BATCH_ROUNDS = 4_000_000
+# Big player bets in spotter minimums when no spread is given.
+DEFAULT_BIG_PLAYER_SPREAD = {2: 10.0, 3: 15.0, 4: 20.0}
+
+@njit(cache=True)
+def _next_seat(true_counts: np.ndarray, s: int, r: int, seat: int, entry_tc: float, exit_tc: float) -> tuple[int, bool]:
+    """
+    Seat for tick r of session s given the seat held at the previous tick (-1
+    = watching): stay unless the count fell below exit_tc or the table is
+    shuffling, otherwise join the table with the highest count at or above
+    entry_tc. Returns (seat, whether a table was entered).
+    """
+    if seat >= 0:
+        tc = true_counts[s, seat, r]
+        if not np.isnan(tc) and tc >= exit_tc: return seat, False
+    seat = -1
+    best = -np.inf
+    for m in range(true_counts.shape[1]):
+        tc = true_counts[s, m, r]
+        if not np.isnan(tc) and tc >= entry_tc and tc > best:
+            best, seat = tc, m
+    return seat, seat >= 0
+
+@njit(cache=True)
+def _ramp_bet(bet_units: np.ndarray, tc_min: int, true_count: float) -> float:
+    return bet_units[min(max(int(math.floor(true_count)) - tc_min, 0), bet_units.shape[0] - 1)]
+
+@njit(parallel=True, cache=True)
+def play_wonging(
+    true_counts: np.ndarray, outcomes: np.ndarray, entry_tc: float, exit_tc: float,
+    tc_min: int, bet_units: np.ndarray
+) -> tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Applies the entry/exit rule to recorded tables. true_counts is
+    (sessions, tables, ticks) and outcomes (sessions, tables, ticks, spots);
+    the player uses spot 0 and bets bet_units[floor(tc) - tc_min] (clamped).
+    When seated, the player leaves before a round whose count is below exit_tc
+    or that is not dealt (shuffle); when not seated, they join the watched
+    table with the highest count at or above entry_tc. Returns per session the
+    units won, the sum of squared round results, rounds played and entries.
+    """
+    n_sessions, n_ticks = true_counts.shape[0], true_counts.shape[2]
+    won = np.zeros(n_sessions)
+    won_sq = np.zeros(n_sessions)
+    played = np.zeros(n_sessions, dtype=np.int64)
+    entries = np.zeros(n_sessions, dtype=np.int64)
+
+    for s in prange(n_sessions):
+        seat = -1
+        for r in range(n_ticks):
+            seat, entered = _next_seat(true_counts, s, r, seat, entry_tc, exit_tc)
+            if entered: entries[s] += 1
+            if seat < 0: continue
+            result = outcomes[s, seat, r, 0] * _ramp_bet(bet_units, tc_min, true_counts[s, seat, r])
+            won[s] += result
+            won_sq[s] += result * result
+            played[s] += 1
+    return won, won_sq, played, entries
+
+@njit(parallel=True, cache=True)
+def play_team(
+    true_counts: np.ndarray, outcomes: np.ndarray, entry_tc: float, exit_tc: float,
+    spotter_bet: float, tc_min: int, bet_units: np.ndarray
+) -> tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Team play over recorded tables with two spots each. A spotter bets
+    spotter_bet on spot 0 of every dealt round at every table; the big player
+    moves between tables as in play_wonging and bets the ramp on spot 1.
+    Returns per session the spotters' units won, the big player's units won,
+    the big player's rounds played and entries.
+    """
+    n_sessions, n_tables, n_ticks = true_counts.shape
+    spotters = np.zeros(n_sessions)
+    big = np.zeros(n_sessions)
+    big_rounds = np.zeros(n_sessions, dtype=np.int64)
+    entries = np.zeros(n_sessions, dtype=np.int64)
+
+    for s in prange(n_sessions):
+        seat = -1
+        for r in range(n_ticks):
+            for m in range(n_tables):
+                if not np.isnan(true_counts[s, m, r]): spotters[s] += outcomes[s, m, r, 0] * spotter_bet
+            seat, entered = _next_seat(true_counts, s, r, seat, entry_tc, exit_tc)
+            if entered: entries[s] += 1
+            if seat < 0: continue
+            big[s] += outcomes[s, seat, r, 1] * _ramp_bet(bet_units, tc_min, true_counts[s, seat, r])
+            big_rounds[s] += 1
+    return spotters, big, big_rounds, entries
+
+def deal_sessions(
+    n_sessions: int, n_tables: int, n_ticks: int, n_spots: int, decks: int, penetration: float,
+    shuffle_ticks: int, others_before: int | Sequence[str], others_after: int | Sequence[str], seed: int
+):
+    """
+    Yields (true_counts, outcomes) for consecutive batches of sessions, shaped
+    (sessions, tables, ticks) and (sessions, tables, ticks, spots). Session s
+    owns tables s * n_tables .. s * n_tables + n_tables - 1, so results do not
+    depend on the batch size.
+    """
+    fresh = shoe.Shoe(decks=decks)
+    shoe_counts = simulator.FastSimulator(fresh.get_remaining_cards()).shoe_counts
+    min_cards = int(round(fresh.initial_card_count * (1.0 - penetration)))
+    seats_before, seats_after = simulator.seat_codes(others_before), simulator.seat_codes(others_after)
+    per_batch = max(1, BATCH_ROUNDS // (n_tables * n_ticks))
+    for start in range(0, n_sessions, per_batch):
+        count = min(per_batch, n_sessions - start)
+        tc, outcomes = whole_shoe.deal_tables(
+            shoe_counts, count * n_tables, n_ticks, n_spots, seed, start * n_tables,
+            min_cards, shuffle_ticks, seats_before, seats_after)
+        yield tc.reshape(count, n_tables, n_ticks), outcomes.reshape(count, n_tables, n_ticks, n_spots)
+
+def simulate_backcounting(
+    n_tables: int = 4,
+    entry_tc: float = 2.0,
+    exit_tc: float = 0.0,
+    hours: float = 1.0,
+    n_sessions: int = 20_000,
+    decks: int = 8,
+    penetration: float = 0.75,
+    rounds_per_hour: int = 100,
+    shuffle_rounds: int = 2,
+    others_before: int | Sequence[str] = 0,
+    others_after: int | Sequence[str] = 0,
+    bet_spread: dict[int, float] | None = None,
+    tc_min: int = -6,
+    tc_max: int = 6,
+    seed: int | None = None
+) -> dict:
+    """
+    Simulates n_sessions sessions of `hours` hours each, watching n_tables
+    tables that deal rounds_per_hour rounds an hour. Reports the hourly win
+    rate and its standard deviation, rounds played per hour, the share of time
+    seated, the EV per round played and table entries per hour. bet_spread is
+    as in whole_shoe.bet_ramp (default flat 1 unit).
+    """
+    if exit_tc > entry_tc:
+        raise ValueError("The exit count must not be above the entry count.")
+    n_ticks = max(1, int(round(hours * rounds_per_hour)))
+    bet_units = whole_shoe.bet_ramp(tc_min, tc_max, bet_spread)
+    seed = random.getrandbits(63) if seed is None else seed
+
+    won, won_sq, played, entries = [], [], [], []
+    for tc, outcomes in deal_sessions(n_sessions, n_tables, n_ticks, 1, decks, penetration, shuffle_rounds,
+                                      others_before, others_after, seed):
+        batch = play_wonging(tc, outcomes, entry_tc, exit_tc, tc_min, bet_units)
+        for out, part in zip((won, won_sq, played, entries), batch): out.append(part)
+    won, won_sq = np.concatenate(won), np.concatenate(won_sq)
+    played, entries = np.concatenate(played), np.concatenate(entries)
+
+    session_hours = n_ticks / rounds_per_hour
+    rounds = int(played.sum())
+    ev_round = float(won.sum() / rounds) if rounds else 0.0
+    return {
+        "tables": n_tables, "entry_tc": entry_tc, "exit_tc": exit_tc, "sessions": n_sessions,
+        "hours_per_session": session_hours, "seed": seed,
+        "win_per_hour": float(won.mean() / session_hours),
+        "std_dev_per_hour": float(won.std(ddof=1) / math.sqrt(session_hours)) if n_sessions > 1 else 0.0,
+        "std_error_per_hour": float(won.std(ddof=1) / session_hours / math.sqrt(n_sessions)) if n_sessions > 1 else 0.0,
+        "rounds_played_per_hour": float(played.mean() / session_hours),
+        "seated_fraction": float(played.mean() / n_ticks),
+        "ev_per_round_played": ev_round,
+        "std_dev_per_round_played": float(math.sqrt(max(won_sq.sum() / rounds - ev_round ** 2, 0.0))) if rounds else 0.0,
+        "entries_per_hour": float(entries.mean() / session_hours),
+    }
+
+def simulate_team(
+    n_spotters: int = 4,
+    entry_tc: float = 2.0,
+    exit_tc: float = 0.0,
+    hours: float = 1.0,
+    n_sessions: int = 20_000,
+    decks: int = 8,
+    penetration: float = 0.75,
+    rounds_per_hour: int = 100,
+    shuffle_rounds: int = 2,
+    others_before: int | Sequence[str] = 0,
+    others_after: int | Sequence[str] = 0,
+    spotter_bet: float = 1.0,
+    big_bet_spread: dict[int, float] | None = None,
+    bankroll_units: Sequence[float] = (500, 1000, 2000, 5000),
+    tc_min: int = -6,
+    tc_max: int = 6,
+    seed: int | None = None
+) -> dict:
+    """
+    Simulates n_sessions sessions of a team: n_spotters spotters, one per
+    table, betting spotter_bet units flat, and a big player who joins the
+    hottest signalled table at entry_tc and leaves below exit_tc, betting
+    big_bet_spread (default DEFAULT_BIG_PLAYER_SPREAD). Reports hourly EV and
+    standard deviation for the team and each role, and the team's risk of
+    ruin for each bankroll (in units) by the diffusion approximation on the
+    hourly figures, which keeps the correlation between the spots.
+    """
+    if exit_tc > entry_tc:
+        raise ValueError("The exit count must not be above the entry count.")
+    n_ticks = max(1, int(round(hours * rounds_per_hour)))
+    bet_units = whole_shoe.bet_ramp(tc_min, tc_max, big_bet_spread or DEFAULT_BIG_PLAYER_SPREAD)
+    seed = random.getrandbits(63) if seed is None else seed
+
+    spotters, big, big_rounds, entries = [], [], [], []
+    for tc, outcomes in deal_sessions(n_sessions, n_spotters, n_ticks, 2, decks, penetration, shuffle_rounds,
+                                      others_before, others_after, seed):
+        batch = play_team(tc, outcomes, entry_tc, exit_tc, spotter_bet, tc_min, bet_units)
+        for out, part in zip((spotters, big, big_rounds, entries), batch): out.append(part)
+    spotters, big = np.concatenate(spotters), np.concatenate(big)
+    big_rounds, entries = np.concatenate(big_rounds), np.concatenate(entries)
+    team = spotters + big
+
+    session_hours = n_ticks / rounds_per_hour
+    def hourly(won: np.ndarray) -> tuple[float, float]:
+        sd = float(won.std(ddof=1) / math.sqrt(session_hours)) if n_sessions > 1 else 0.0
+        return float(won.mean() / session_hours), sd
+
+    team_ev, team_sd = hourly(team)
+    spotter_ev, spotter_sd = hourly(spotters)
+    big_ev, big_sd = hourly(big)
+    return {
+        "spotters": n_spotters, "entry_tc": entry_tc, "exit_tc": exit_tc, "sessions": n_sessions,
+        "hours_per_session": session_hours, "seed": seed,
+        "team_ev_per_hour": team_ev, "team_std_dev_per_hour": team_sd,
+        "team_std_error_per_hour": team_sd / math.sqrt(n_sessions),
+        "team_variance_per_hour": team_sd ** 2,
+        "spotter_ev_per_hour": spotter_ev, "spotter_std_dev_per_hour": spotter_sd,
+        "big_player_ev_per_hour": big_ev, "big_player_std_dev_per_hour": big_sd,
+        "big_player_rounds_per_hour": float(big_rounds.mean() / session_hours),
+        "big_player_entries_per_hour": float(entries.mean() / session_hours),
+        "big_player_ev_per_round": float(big.sum() / big_rounds.sum()) if big_rounds.sum() else 0.0,
+        "risk_of_ruin": {float(units): strategy.risk_of_ruin(team_ev, team_sd, units) for units in bankroll_units},
+        "bankroll_for_5pct_ror": strategy.bankroll_for_risk(team_ev, team_sd, 0.05),
+    }
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Simulate back-counting across several tables.")
+    parser.add_argument("--tables", type=int, default=4, help="Tables watched (one spotter each with --team).")
+    parser.add_argument("--team", action="store_true", help="Simulate spotters and a big player.")
+    parser.add_argument("--entry", type=float, default=2.0, help="True count to take a seat at.")
+    parser.add_argument("--exit", type=float, default=0.0, help="Leave when the true count drops below this.")
+    parser.add_argument("--hours", type=float, default=1.0)
+    parser.add_argument("--sessions", type=int, default=20_000)
+    parser.add_argument("--decks", type=int, default=8)
+    parser.add_argument("--penetration", type=float, default=0.75)
+    parser.add_argument("--rounds-per-hour", type=int, default=100)
+    parser.add_argument("--spread", help='Bet spread as JSON, e.g. \'{"1": 1, "2": 4, "4": 8}\'.')
+    parser.add_argument("--others", type=int, default=0, help="Other players per table (half act before the spot).")
+    parser.add_argument("--others-strategy", choices=simulator.SEAT_STRATEGIES, default="basic")
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args(argv)
+
+    spread = {int(k): float(v) for k, v in json.loads(args.spread).items()} if args.spread else None
+    others_before = [args.others_strategy] * (args.others // 2)
+    others_after = [args.others_strategy] * (args.others - args.others // 2)
+    if args.team:
+        result = simulate_team(
+            args.tables, args.entry, args.exit, args.hours, args.sessions, args.decks, args.penetration,
+            args.rounds_per_hour, others_before=others_before, others_after=others_after,
+            big_bet_spread=spread, seed=args.seed)
+    else:
+        result = simulate_backcounting(
+            args.tables, args.entry, args.exit, args.hours, args.sessions, args.decks, args.penetration,
+            args.rounds_per_hour, others_before=others_before, others_after=others_after,
+            bet_spread=spread, seed=args.seed)
+    print(json.dumps(result, indent=2))
+
+if __name__ == "__main__":
+    main()
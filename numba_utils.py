@@ -38,16 +38,58 @@ def get_hand_total(hand_ranks: np.ndarray) -> tuple[int, bool]:
     return total, is_soft
 
 @njit(cache=True)
-def draw_card(temp_shoe: np.ndarray) -> int:
+def get_hard_value_numba(rank: int) -> int:
+    """Blackjack value of a rank with Aces counted as 1."""
+    if rank >= 9: return 10
+    return rank + 1
+
+@njit(cache=True)
+def add_card_to_hand(hard_total: int, aces: int, rank: int) -> tuple[int, int]:
+    """Adds a card to an incremental hand state of (hard total, number of aces)."""
+    return hard_total + get_hard_value_numba(rank), aces + (1 if rank == 0 else 0)
+
+@njit(cache=True)
+def hand_state_total(hard_total: int, aces: int) -> tuple[int, bool]:
     """
-    Draws a single card index from the shoe array, returning -1 if empty.
-    This function modifies the temp_shoe array in place.
+    get_hand_total for an incremental hand state, with the same semantics:
+    one Ace counts as 11 when that does not bust the hand, and is_soft is True
+    whenever the hand holds an Ace and has not busted.
     """
-    total_cards = np.sum(temp_shoe)
-    if total_cards == 0:
-        return -1
+    if aces > 0 and hard_total + 10 <= 21: return hard_total + 10, True
+    return hard_total, aces > 0 and hard_total <= 21
+
+# --- Counter-based random streams ---
+# Each simulated round owns an independent stream derived from (seed, round index),
+# so results do not depend on how rounds are split across threads, processes or hosts.
+_GOLDEN_GAMMA = np.uint64(0x9E3779B97F4A7C15)
+_MIX_1 = np.uint64(0xBF58476D1CE4E5B9)
+_MIX_2 = np.uint64(0x94D049BB133111EB)
+_UNIT_SCALE = 1.0 / 9007199254740992.0  # 2**-53
+
+@njit(cache=True)
+def _mix64(z: np.uint64) -> np.uint64:
+    """SplitMix64 finalizer: a bijective avalanche mix of a 64-bit word."""
+    z = (z ^ (z >> np.uint64(30))) * _MIX_1
+    z = (z ^ (z >> np.uint64(27))) * _MIX_2
+    return z ^ (z >> np.uint64(31))
 
-    rand_val = np.random.random() * total_cards
+@njit(cache=True)
+def rng_stream_state(seed: int, stream: int) -> np.uint64:
+    """Returns the starting state of stream number `stream` under `seed`."""
+    return _mix64(np.uint64(seed) ^ _mix64((np.uint64(stream) + np.uint64(1)) * _GOLDEN_GAMMA))
+
+@njit(cache=True)
+def rng_uniform(rng_state: np.ndarray) -> float:
+    """
+    Returns a uniform float in [0, 1) and advances the 1-element uint64
+    state array in place.
+    """
+    rng_state[0] += _GOLDEN_GAMMA
+    return (_mix64(rng_state[0]) >> np.uint64(11)) * _UNIT_SCALE
+
+@njit(cache=True)
+def _take_card(temp_shoe: np.ndarray, rand_val: float) -> int:
+    """Removes and returns the card index selected by rand_val in [0, total_cards)."""
     cumulative_sum = 0.0
     for j in range(52):
         cumulative_sum += temp_shoe[j]
@@ -62,32 +104,127 @@ def draw_card(temp_shoe: np.ndarray) -> int:
             
     return -1
 
+@njit(cache=True)
+def draw_card(temp_shoe: np.ndarray) -> int:
+    """
+    Draws a single card index from the shoe array, returning -1 if empty.
+    This function modifies the temp_shoe array in place.
+    """
+    total_cards = np.sum(temp_shoe)
+    if total_cards == 0:
+        return -1
+    return _take_card(temp_shoe, np.random.random() * total_cards)
+
+@njit(cache=True)
+def draw_card_rng(temp_shoe: np.ndarray, rng_state: np.ndarray) -> int:
+    """Same as draw_card, but driven by a counter-based stream (see rng_uniform)."""
+    total_cards = np.sum(temp_shoe)
+    if total_cards == 0:
+        return -1
+    return _take_card(temp_shoe, rng_uniform(rng_state) * total_cards)
+
+# --- Scratch shoes with an undo log ---
+# A scratch shoe is a reusable per-thread copy of a 52-card shoe array with the
+# remaining card total kept in slot SHOE_TOTAL. Draws are recorded in an undo log
+# (log[0] holds the number of entries) so a round's cards can be put back without
+# copying the shoe again.
+SHOE_TOTAL = 52
+UNDO_CAPACITY = 64  # default capacity; far above the most cards a single round can consume
+
+@njit(cache=True)
+def make_scratch_shoe(shoe_counts: np.ndarray) -> np.ndarray:
+    scratch = np.zeros(53, dtype=np.int64)
+    for j in range(52):
+        scratch[j] = shoe_counts[j]
+    scratch[SHOE_TOTAL] = np.sum(scratch[:52])
+    return scratch
+
+@njit(cache=True)
+def make_undo_log(capacity: int = UNDO_CAPACITY) -> np.ndarray:
+    """An empty undo log holding up to `capacity` draws; draws beyond it fail like an empty shoe."""
+    return np.zeros(capacity + 1, dtype=np.int64)
+
+@njit(cache=True)
+def _take_logged(scratch: np.ndarray, undo_log: np.ndarray, rand_unit: float) -> int:
+    idx = _take_card(scratch, rand_unit * scratch[SHOE_TOTAL])
+    scratch[SHOE_TOTAL] -= 1
+    undo_log[0] += 1
+    undo_log[undo_log[0]] = idx
+    return idx
+
+@njit(cache=True)
+def draw_scratch_card(scratch: np.ndarray, undo_log: np.ndarray) -> int:
+    """draw_card for a scratch shoe; the drawn card is recorded in undo_log."""
+    if scratch[SHOE_TOTAL] == 0 or undo_log[0] >= undo_log.shape[0] - 1: return -1
+    return _take_logged(scratch, undo_log, np.random.random())
+
+@njit(cache=True)
+def draw_scratch_card_rng(scratch: np.ndarray, undo_log: np.ndarray, rng_state: np.ndarray) -> int:
+    """
+    draw_card_rng for a scratch shoe. Draws the same card as draw_card_rng
+    would from the equivalent plain shoe, and records it in undo_log.
+    """
+    if scratch[SHOE_TOTAL] == 0 or undo_log[0] >= undo_log.shape[0] - 1: return -1
+    return _take_logged(scratch, undo_log, rng_uniform(rng_state))
+
+@njit(cache=True)
+def restore_scratch_shoe(scratch: np.ndarray, undo_log: np.ndarray) -> None:
+    """Puts every card recorded in undo_log back into the scratch shoe and clears the log."""
+    n = undo_log[0]
+    for j in range(1, n + 1):
+        scratch[undo_log[j]] += 1
+    scratch[SHOE_TOTAL] += n
+    undo_log[0] = 0
+
+# Hi-Lo tag of each rank index (0=A, 1=2, ..., 12=K).
+HILO_TAGS = np.array([-1, 1, 1, 1, 1, 1, 0, 0, 0, -1, -1, -1, -1], dtype=np.float64)
+
+@njit(cache=True)
+def hilo_true_count(scratch: np.ndarray) -> float:
+    """
+    Hi-Lo true count of the cards already dealt from a full shoe, read off the
+    remaining composition of a scratch shoe (the count is balanced, so the
+    running count is minus the tag sum of the cards left).
+    """
+    left = scratch[SHOE_TOTAL]
+    if left == 0: return 0.0
+    running_count = 0.0
+    for j in range(52):
+        running_count -= HILO_TAGS[j % 13] * scratch[j]
+    return running_count * 52.0 / left
+
 @njit(cache=True)
 def evaluate_perfect_pairs_numba(p_ranks: np.ndarray, p_suits: np.ndarray) -> float:
     """Numba-compatible evaluation of Perfect Pairs side bet."""
-    if p_ranks[0] != p_ranks[1]: return -1.0
-    if p_suits[0] == p_suits[1]: return 25.0
+    return evaluate_perfect_pairs_cards(p_ranks[0], p_ranks[1], p_suits[0], p_suits[1])
+
+@njit(cache=True)
+def evaluate_perfect_pairs_cards(r1: int, r2: int, s1: int, s2: int) -> float:
+    """Allocation-free Perfect Pairs evaluation from the two player cards' ranks and suits."""
+    if r1 != r2: return -1.0
+    if s1 == s2: return 25.0
     
-    is_c1_red = (p_suits[0] == 1 or p_suits[0] == 2)
-    is_c2_red = (p_suits[1] == 1 or p_suits[1] == 2)
+    is_c1_red = (s1 == 1 or s1 == 2)
+    is_c2_red = (s2 == 1 or s2 == 2)
     return 12.0 if is_c1_red == is_c2_red else 6.0
 
 @njit(cache=True)
 def evaluate_21plus3_numba(p_ranks: np.ndarray, d_rank: int, p_suits: np.ndarray, d_suit: int) -> float:
     """Numba-compatible evaluation of 21+3 side bet."""
-    ranks = np.array([p_ranks[0], p_ranks[1], d_rank])
-    suits = np.array([p_suits[0], p_suits[1], d_suit])
-    
-    is_flush = (suits[0] == suits[1] == suits[2])
-    # FIX: Removed return_counts=True for Numba compatibility
-    unique_ranks = np.unique(ranks)
-    is_three_kind = (len(unique_ranks) == 1)
+    return evaluate_21plus3_cards(p_ranks[0], p_ranks[1], d_rank, p_suits[0], p_suits[1], d_suit)
+
+@njit(cache=True)
+def evaluate_21plus3_cards(r1: int, r2: int, r3: int, s1: int, s2: int, s3: int) -> float:
+    """Allocation-free 21+3 evaluation from the two player cards and the dealer upcard."""
+    is_flush = (s1 == s2 == s3)
+    is_three_kind = (r1 == r2 == r3)
 
     if is_three_kind and is_flush: return 100.0
-    
-    sorted_ranks = np.sort(unique_ranks)
-    is_straight = (len(sorted_ranks) == 3 and (sorted_ranks[2] - sorted_ranks[0] == 2)) or \
-                  (np.all(np.isin(np.array([0, 11, 12]), sorted_ranks)))
+
+    lo, mid, hi = min(r1, r2, r3), r1 + r2 + r3 - min(r1, r2, r3) - max(r1, r2, r3), max(r1, r2, r3)
+    distinct = lo != mid and mid != hi
+    # Consecutive ranks, or Q-K-A with the Ace high.
+    is_straight = distinct and (hi - lo == 2 or (lo == 0 and mid == 11 and hi == 12))
     
     if is_straight and is_flush: return 40.0
     if is_three_kind: return 30.0
@@ -99,15 +236,21 @@ def evaluate_21plus3_numba(p_ranks: np.ndarray, d_rank: int, p_suits: np.ndarray
 @njit(cache=True)
 def evaluate_hot3_numba(p_ranks: np.ndarray, d_rank: int) -> float:
     """Numba-compatible evaluation of Hot 3 side bet (simplified, no suit check)."""
-    three_card_hand = np.array([p_ranks[0], p_ranks[1], d_rank])
-    
-    if three_card_hand[0] == 6 and three_card_hand[1] == 6 and three_card_hand[2] == 6: 
+    return evaluate_hot3_cards(p_ranks[0], p_ranks[1], d_rank)
+
+@njit(cache=True)
+def evaluate_hot3_cards(r1: int, r2: int, r3: int) -> float:
+    """Allocation-free Hot 3 evaluation from the three card ranks."""
+    if r1 == 6 and r2 == 6 and r3 == 6: 
         return 100.0
         
-    total, _ = get_hand_total(three_card_hand)
+    hard_total, aces = add_card_to_hand(0, 0, r1)
+    hard_total, aces = add_card_to_hand(hard_total, aces, r2)
+    hard_total, aces = add_card_to_hand(hard_total, aces, r3)
+    total, _ = hand_state_total(hard_total, aces)
     
     if total == 21: return 10.0
     if total == 20: return 2.0
     if total == 19: return 1.0
     
-    return -1.0
\ No newline at end of file
+    return -1.0
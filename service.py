@@ -0,0 +1,328 @@
+"""
+Headless simulation service. Exposes shoe tracking, EV, decision advice and
+side-bet analysis for many tables over a small JSON/HTTP API on localhost,
+without the PyQt GUI.
+
+Concurrent EV and side-bet requests from different tables are collected by a
+KernelBatcher for a short window and evaluated together in a single
+vectorized kernel launch (simulator.simulate_batch and
+bayesian_predictor.run_side_bet_batch). Results are cached per table until
+its shoe changes.
+
+    python service.py --port 8765
+
+Endpoints (table ids are arbitrary strings; tables are created on first use):
+    GET  /tables/<id>                 shoe and count state
+    POST /tables/<id>/cards           {"card": "AS", "action": "remove" | "restore"}
+    POST /tables/<id>/reset           reshuffle the table's shoe
+    GET  /tables/<id>/ev              main and side-bet EVs for the next round
+    GET  /tables/<id>/sidebets        immediate side-bet EVs
+    POST /tables/<id>/advice          {"player": ["10S", "6H"], "dealer": "9D"}
+    GET  /stats                       per-endpoint latency percentiles
+"""
+from __future__ import annotations
+import argparse
+import json
+import queue
+import threading
+import time
+from collections import defaultdict, deque
+from concurrent.futures import Future
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import numpy as np
+
+import bayesian_predictor
+import counting
+import decision_advisor
+import shoe
+import simulator
+
+DEFAULT_CONFIG = {
+    "decks": 8,
+    "ev_rounds": 2_000,
+    "sidebet_rounds": 5_000,
+    "max_batch": 64,
+    "max_wait_ms": 1.0,
+}
+
+class KernelBatcher:
+    """
+    Collects shoe-count vectors submitted from many threads and evaluates them
+    in one call of `kernel(shoe_matrix) -> per-row results`. A batch is launched
+    as soon as max_batch requests are waiting or max_wait_ms has passed since
+    the first one arrived.
+
+    Every batcher runs its own thread, but kernels are launched one at a time
+    under simulator.KERNEL_LAUNCH_LOCK.
+    """
+    launch_lock = simulator.KERNEL_LAUNCH_LOCK
+
+    def __init__(self, kernel, max_batch: int = 64, max_wait_ms: float = 1.0):
+        self.kernel = kernel
+        self.max_batch = max_batch
+        self.max_wait = max_wait_ms / 1000.0
+        self.batches_run = 0
+        self.requests_served = 0
+        self._queue: queue.Queue = queue.Queue()
+        self._thread = threading.Thread(target=self._loop, daemon=True)
+        self._thread.start()
+
+    def submit(self, shoe_counts: np.ndarray) -> Future:
+        """Queues one shoe for the next batch and returns a future for its row of results."""
+        future: Future = Future()
+        self._queue.put((shoe_counts, future))
+        return future
+
+    def _loop(self) -> None:
+        while True:
+            batch = [self._queue.get()]
+            deadline = time.perf_counter() + self.max_wait
+            while len(batch) < self.max_batch:
+                remaining = deadline - time.perf_counter()
+                if remaining <= 0: break
+                try:
+                    batch.append(self._queue.get(timeout=remaining))
+                except queue.Empty:
+                    break
+
+            try:
+                with self.launch_lock:
+                    results = self.kernel(np.stack([counts for counts, _ in batch]))
+                for (_, future), row in zip(batch, results):
+                    future.set_result(row)
+            except Exception as e:
+                for _, future in batch:
+                    if not future.done(): future.set_exception(e)
+            self.batches_run += 1
+            self.requests_served += len(batch)
+
+class TableState:
+    """The tracked shoe and running counts of one table."""
+    def __init__(self, decks: int):
+        self.shoe = shoe.Shoe(decks=decks)
+        self.counters = {
+            "Hi-Lo": counting.HiLoCount(), "Zen": counting.ZenCount(),
+            "Wong Halves": counting.WongHalves(), "Omega II": counting.Omega2Count(),
+        }
+        self.version = 0
+        self.cache: dict[str, tuple[int, dict]] = {}
+        self.lock = threading.Lock()
+
+    def shoe_counts(self) -> np.ndarray:
+        return simulator.FastSimulator(self.shoe.get_remaining_cards()).shoe_counts
+
+    def snapshot(self) -> dict:
+        decks_remaining = self.shoe.decks_remaining()
+        return {
+            "cards_remaining": self.shoe.total_cards,
+            "initial_cards": self.shoe.initial_card_count,
+            "penetration": self.shoe.get_penetration(),
+            "counts": {
+                name: {"rc": c.running_count, "tc": c.true_count(decks_remaining)}
+                for name, c in self.counters.items()
+            },
+        }
+
+class SimulationService:
+    """Table registry plus batched EV and side-bet evaluation."""
+    def __init__(self, config: dict | None = None):
+        self.config = {**DEFAULT_CONFIG, **(config or {})}
+        self.tables: dict[str, TableState] = {}
+        self._tables_lock = threading.Lock()
+        self._seed = int(np.random.randint(0, 2**31 - 1))
+        ev_rounds, sidebet_rounds = self.config["ev_rounds"], self.config["sidebet_rounds"]
+        self.ev_batcher = KernelBatcher(
+            lambda m: simulator.simulate_batch(m, ev_rounds, self._seed, 0),
+            self.config["max_batch"], self.config["max_wait_ms"])
+        self.sidebet_batcher = KernelBatcher(
+            lambda m: bayesian_predictor.run_side_bet_batch(m, sidebet_rounds, self._seed, 0) / sidebet_rounds,
+            self.config["max_batch"], self.config["max_wait_ms"])
+
+    def warmup(self) -> None:
+        """Triggers JIT compilation of both kernels before serving traffic."""
+        counts = TableState(self.config["decks"]).shoe_counts()[np.newaxis, :]
+        with KernelBatcher.launch_lock:
+            simulator.simulate_batch(counts, 1, 0, 0)
+            bayesian_predictor.run_side_bet_batch(counts, 1, 0, 0)
+
+    def table(self, table_id: str) -> TableState:
+        with self._tables_lock:
+            if table_id not in self.tables:
+                self.tables[table_id] = TableState(self.config["decks"])
+            return self.tables[table_id]
+
+    def update_card(self, table_id: str, card: str, action: str = "remove") -> dict:
+        """Removes (dealt) or restores (undo) a card and updates the counts."""
+        table = self.table(table_id)
+        with table.lock:
+            if action == "remove":
+                table.shoe.remove_card(card)
+                for counter in table.counters.values(): counter.update(card)
+            elif action == "restore":
+                table.shoe.restore_card(card)
+                for counter in table.counters.values(): counter.undo(card)
+            else:
+                raise ValueError(f"Unknown card action '{action}'.")
+            table.version += 1
+            return table.snapshot()
+
+    def reset(self, table_id: str) -> dict:
+        table = self.table(table_id)
+        with table.lock:
+            table.shoe.reset_shoe()
+            for counter in table.counters.values(): counter.reset()
+            table.version += 1
+            return table.snapshot()
+
+    def state(self, table_id: str) -> dict:
+        table = self.table(table_id)
+        with table.lock:
+            return table.snapshot()
+
+    def _cached_batch(self, table_id: str, key: str, batcher: KernelBatcher, to_result) -> dict:
+        table = self.table(table_id)
+        with table.lock:
+            version = table.version
+            cached = table.cache.get(key)
+            if cached and cached[0] == version: return cached[1]
+            counts = table.shoe_counts()
+        result = to_result(batcher.submit(counts).result())
+        with table.lock:
+            if table.version == version: table.cache[key] = (version, result)
+        return result
+
+    def ev(self, table_id: str) -> dict:
+        """Mean EV per bet type for the next round, with standard errors."""
+        rounds = self.config["ev_rounds"]
+
+        def to_result(totals: np.ndarray) -> dict:
+            accumulator = simulator.SimAccumulator()
+            accumulator.add_chunk(totals, rounds)
+            return {"rounds": rounds, "ev": accumulator.mean(), "std_error": accumulator.std_error()}
+        return self._cached_batch(table_id, "ev", self.ev_batcher, to_result)
+
+    def sidebets(self, table_id: str) -> dict:
+        """Immediate, composition-dependent side-bet EVs."""
+        def to_result(row: np.ndarray) -> dict:
+            return {key: float(row[0, k]) for k, key in enumerate(bayesian_predictor.SIDE_BET_KEYS)}
+        return self._cached_batch(table_id, "sidebets", self.sidebet_batcher, to_result)
+
+    def advice(self, table_id: str, player: list[str], dealer: str) -> dict:
+        """Basic strategy and index-play advice using the table's Hi-Lo true count."""
+        table = self.table(table_id)
+        with table.lock:
+            tc = table.counters["Hi-Lo"].true_count(table.shoe.decks_remaining())
+        return {"action": decision_advisor.recommend_action(player, dealer, tc), "true_count": tc}
+
+class LatencyRecorder:
+    """Keeps the most recent request latencies per endpoint."""
+    def __init__(self, window: int = 10_000):
+        self._samples: dict[str, deque] = defaultdict(lambda: deque(maxlen=window))
+        self._lock = threading.Lock()
+
+    def record(self, endpoint: str, seconds: float) -> None:
+        with self._lock:
+            self._samples[endpoint].append(seconds * 1000.0)
+
+    def summary(self) -> dict:
+        with self._lock:
+            return {
+                endpoint: {
+                    "count": len(samples),
+                    "p50_ms": float(np.percentile(samples, 50)),
+                    "p99_ms": float(np.percentile(samples, 99)),
+                }
+                for endpoint, samples in self._samples.items() if samples
+            }
+
+def make_handler(service: SimulationService, latencies: LatencyRecorder):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format, *args):
+            pass
+
+        def _send(self, status: int, payload: dict) -> None:
+            body = json.dumps(payload).encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def _dispatch(self, method: str) -> None:
+            start = time.perf_counter()
+            parts = [p for p in self.path.split("?")[0].split("/") if p]
+            length = int(self.headers.get("Content-Length") or 0)
+            endpoint = "unknown"
+            try:
+                body = json.loads(self.rfile.read(length)) if length else {}
+                if method == "GET" and parts == ["stats"]:
+                    endpoint = "stats"
+                    result = {"latency": latencies.summary(), "batches": {
+                        "ev": service.ev_batcher.batches_run, "sidebets": service.sidebet_batcher.batches_run}}
+                elif len(parts) >= 2 and parts[0] == "tables":
+                    table_id, action = parts[1], (parts[2] if len(parts) > 2 else "")
+                    endpoint = f"{method} {action or 'state'}"
+                    if method == "GET" and action == "":
+                        result = service.state(table_id)
+                    elif method == "GET" and action == "ev":
+                        result = service.ev(table_id)
+                    elif method == "GET" and action == "sidebets":
+                        result = service.sidebets(table_id)
+                    elif method == "POST" and action == "cards":
+                        result = service.update_card(table_id, body["card"], body.get("action", "remove"))
+                    elif method == "POST" and action == "reset":
+                        result = service.reset(table_id)
+                    elif method == "POST" and action == "advice":
+                        result = service.advice(table_id, body.get("player", []), body.get("dealer", ""))
+                    else:
+                        self._send(404, {"error": f"Unknown endpoint {method} {self.path}"})
+                        return
+                else:
+                    self._send(404, {"error": f"Unknown endpoint {method} {self.path}"})
+                    return
+                self._send(200, result)
+            except (ValueError, KeyError, TypeError) as e:
+                self._send(400, {"error": str(e)})
+            except Exception as e:
+                self._send(500, {"error": str(e)})
+            finally:
+                latencies.record(endpoint, time.perf_counter() - start)
+
+        def do_GET(self):
+            self._dispatch("GET")
+
+        def do_POST(self):
+            self._dispatch("POST")
+
+    return Handler
+
+def serve(host: str = "127.0.0.1", port: int = 8765, config: dict | None = None) -> None:
+    """Starts the service and blocks until interrupted."""
+    service = SimulationService(config)
+    service.warmup()
+    server = ThreadingHTTPServer((host, port), make_handler(service, LatencyRecorder()))
+    server.daemon_threads = True
+    print(f"Simulation service listening on http://{host}:{port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Headless Blackjack simulation service.")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8765)
+    parser.add_argument("--decks", type=int, default=DEFAULT_CONFIG["decks"])
+    parser.add_argument("--ev-rounds", type=int, default=DEFAULT_CONFIG["ev_rounds"])
+    parser.add_argument("--sidebet-rounds", type=int, default=DEFAULT_CONFIG["sidebet_rounds"])
+    parser.add_argument("--max-wait-ms", type=float, default=DEFAULT_CONFIG["max_wait_ms"])
+    args = parser.parse_args()
+    serve(args.host, args.port, {
+        "decks": args.decks, "ev_rounds": args.ev_rounds,
+        "sidebet_rounds": args.sidebet_rounds, "max_wait_ms": args.max_wait_ms,
+    })
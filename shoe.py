@@ -35,6 +35,18 @@ class Shoe:
         self.cards = {f"{r}{s}": self.decks for r in ranks for s in suits}
         self.total_cards = self.initial_card_count
 
+    def copy(self) -> Shoe:
+        """
+        Returns an independent copy of the shoe, e.g. to hand a snapshot to a
+        worker thread while the original keeps changing.
+        """
+        clone = Shoe.__new__(Shoe)
+        clone.decks = self.decks
+        clone.cards = self.cards.copy()
+        clone.total_cards = self.total_cards
+        clone.initial_card_count = self.initial_card_count
+        return clone
+
     def remove_card(self, card_code: str) -> None:
         """
         Removes a single card from the shoe.
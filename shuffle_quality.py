@@ -0,0 +1,375 @@
+"""
+Statistical tests of shuffle quality over recorded shoes. Poor hand shuffles
+leave cards clumped, which shows up as structure in the order cards are dealt
+in. A shoe history file holds the dealt card order of many shoes and is read
+in batches, so files of millions of shoes never have to fit in memory.
+
+Each test computes, per shoe, a statistic minus its exact expectation under a
+random shuffle given the cards that shoe dealt, so every statistic has mean
+zero for a fair shuffle whatever the penetration. Summed over shoes this gives
+a z score and a two-sided p-value:
+
+  runs             Wald-Wolfowitz runs of high cards (Ten, Ace) versus the
+                   rest; clumping gives fewer runs
+  serial_lag_k     products of Hi-Lo tags k cards apart
+  same_rank        adjacent cards of equal rank
+  next_rank        adjacent cards in new-deck rank order
+  block_serial     products of the centred Hi-Lo tag sums of consecutive
+                   ROUND_CARDS-card blocks (about a round each)
+  carryover        card pairs adjacent in one shoe seen again within
+                   CARRYOVER_LAGS cards of each other in the next shoe of the
+                   same sequence
+
+The block statistics also give the expected exploitable edge: the share of a
+round's Hi-Lo tag sum predictable from the round before beyond what a random
+shuffle gives, turned into a true count and then an edge for a player who
+raises only when the prediction is favourable. Carryover is exploited by
+tracking slugs across the shuffle instead; shuffle_tracking simulates that
+edge for a given procedure.
+
+File format: a 16-byte header (b"SHOEHIST", uint16 version, uint16 width,
+4 reserved bytes) and fixed-size records of a uint32 sequence id followed by
+width card bytes (suit * 13 + rank, NO_CARD after the last card dealt).
+Consecutive records with the same sequence id are consecutive shoes of one
+table.
+
+    python shuffle_quality.py history.bin
+    python shuffle_quality.py history.bin --generate --procedure one_pass --sequences 200 --shoes 500
+"""
+from __future__ import annotations
+import argparse
+import json
+import math
+import random
+from typing import Iterator
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+import shuffle_tracking
+from numba_utils import HILO_TAGS, rng_stream_state
+from shuffle_tracking import SLUG_MARK, apply_shuffle, ordered_shoe, _collect_discards, _random_shuffle
+from simulator import num_blocks
+from whole_shoe import PATHS_PER_BLOCK
+
+HISTORY_MAGIC = b"SHOEHIST"
+HISTORY_VERSION = 1
+HEADER_BYTES = 16
+NO_CARD = 255
+
+MAX_LAG = 5
+ROUND_CARDS = 5
+CARRYOVER_LAGS = 3
+# EV gained per point of Hi-Lo true count, the usual rule of thumb.
+EDGE_PER_TRUE_COUNT = 0.005
+
+def stat_keys(max_lag: int = MAX_LAG) -> tuple[str, ...]:
+    """Column names of the per-shoe statistics, for lags 1..max_lag."""
+    return (("runs",) + tuple(f"serial_lag_{k}" for k in range(1, max_lag + 1))
+            + ("same_rank", "next_rank", "block_serial", "carryover", "block_sq", "block_pairs"))
+
+def record_dtype(width: int) -> np.dtype:
+    return np.dtype([("sequence", "<u4"), ("cards", "u1", (width,))])
+
+# --- History files ---
+
+def write_shoe_history(path: str, sequence_ids: np.ndarray, cards: np.ndarray, append: bool = False) -> None:
+    """
+    Writes shoes as history records: cards is (shoes, width) of card indices
+    padded with NO_CARD. With append the file must already have this width.
+
+    Raises:
+        ValueError: If appending to a file of another width.
+    """
+    width = cards.shape[1]
+    records = np.zeros(cards.shape[0], dtype=record_dtype(width))
+    records["sequence"] = sequence_ids
+    records["cards"] = cards
+    if append:
+        with open(path, "rb") as f:
+            if _read_header(f) != width: raise ValueError(f"{path} does not hold {width}-card records.")
+        with open(path, "ab") as f:
+            records.tofile(f)
+        return
+    with open(path, "wb") as f:
+        header = np.zeros(1, dtype=[("magic", "S8"), ("version", "<u2"), ("width", "<u2"), ("reserved", "<u4")])
+        header["magic"], header["version"], header["width"] = HISTORY_MAGIC, HISTORY_VERSION, width
+        header.tofile(f)
+        records.tofile(f)
+
+def _read_header(f) -> int:
+    header = f.read(HEADER_BYTES)
+    if len(header) < HEADER_BYTES or header[:8] != HISTORY_MAGIC:
+        raise ValueError("Not a shoe history file.")
+    version, width = int.from_bytes(header[8:10], "little"), int.from_bytes(header[10:12], "little")
+    if version != HISTORY_VERSION:
+        raise ValueError(f"Unsupported shoe history version {version}.")
+    return width
+
+def read_shoe_history(path: str, batch_shoes: int = 100_000) -> Iterator[tuple[np.ndarray, np.ndarray]]:
+    """Yields (sequence ids, (shoes, width) cards) for consecutive batches of records."""
+    with open(path, "rb") as f:
+        dtype = record_dtype(_read_header(f))
+        while True:
+            records = np.fromfile(f, dtype=dtype, count=batch_shoes)
+            if records.shape[0] == 0: return
+            yield records["sequence"], records["cards"]
+
+@njit(parallel=True)
+def record_sequences(decks: int, n_sequences: int, n_shoes: int, seed: int, program: np.ndarray, dealt: int) -> np.ndarray:
+    """
+    Dealt card order of n_shoes consecutive shoes for each of n_sequences
+    tables, each shoe shuffled from the previous one's discards by the
+    program of shuffle_tracking, after a random first shuffle. The first
+    `dealt` cards of every shoe are recorded; returns
+    (n_sequences * n_shoes, decks * 52) uint8 padded with NO_CARD.
+    """
+    n = decks * 52
+    dealt = min(dealt, n)
+    out = np.full((n_sequences * n_shoes, n), NO_CARD, dtype=np.uint8)
+    with parallel_chunksize(1):
+        for q in prange(n_sequences):
+            rng = np.zeros(1, dtype=np.uint64)
+            rng[0] = rng_stream_state(seed, q)
+            deck = ordered_shoe(decks)
+            buf = np.zeros(n, dtype=np.int64)
+            _random_shuffle(deck, rng)
+            for s in range(n_shoes):
+                for i in range(dealt): out[q * n_shoes + s, i] = deck[i] % SLUG_MARK
+                _collect_discards(deck, buf, dealt)
+                apply_shuffle(deck, buf, program, rng)
+    return out
+
+def generate_history(
+    path: str, procedure: str = "one_pass", decks: int = 6, n_sequences: int = 100, n_shoes: int = 100,
+    penetration: float = 0.75, seed: int | None = None
+) -> None:
+    """Writes a synthetic history of a shuffle procedure, e.g. to check that "random" passes."""
+    seed = random.getrandbits(63) if seed is None else seed
+    cards = record_sequences(decks, n_sequences, n_shoes, seed, shuffle_tracking.parse_procedure(procedure),
+                             int(round(decks * 52 * penetration)))
+    write_shoe_history(path, np.repeat(np.arange(n_sequences, dtype=np.uint32), n_shoes), cards)
+
+# --- Statistics kernel ---
+
+@njit(cache=True)
+def _shoe_length(row: np.ndarray) -> int:
+    m = 0
+    while m < row.shape[0] and row[m] < 52: m += 1
+    return m
+
+@njit(cache=True)
+def _within_shoe_stats(row: np.ndarray, m: int, max_lag: int, rank_counts: np.ndarray, out: np.ndarray) -> None:
+    """Fills every column but carryover for one shoe of m cards (see stat_keys); rank_counts is a (13,) scratch buffer."""
+    rank_counts[:] = 0.0
+    s = q = 0.0
+    high = 0
+    runs = 1.0 if m > 0 else 0.0
+    same = nxt = 0.0
+    for t in range(m):
+        r = row[t] % 13
+        x = HILO_TAGS[r]
+        rank_counts[r] += 1.0
+        s += x
+        q += x * x
+        if x < 0.0: high += 1
+        if t > 0:
+            prev = row[t - 1] % 13
+            if (HILO_TAGS[prev] < 0.0) != (x < 0.0): runs += 1.0
+            if prev == r: same += 1.0
+            if r == (prev + 1) % 13: nxt += 1.0
+    if m < 2: return
+    pairs = m * (m - 1.0)
+    out[0] = runs - (1.0 + 2.0 * high * (m - high) / m)
+
+    pair_product = (s * s - q) / pairs
+    for k in range(1, max_lag + 1):
+        acc = 0.0
+        for t in range(m - k): acc += HILO_TAGS[row[t] % 13] * HILO_TAGS[row[t + k] % 13]
+        out[k] = acc - max(m - k, 0) * pair_product
+
+    same_pairs = next_pairs = 0.0
+    for r in range(13):
+        same_pairs += rank_counts[r] * (rank_counts[r] - 1.0)
+        next_pairs += rank_counts[r] * rank_counts[(r + 1) % 13]
+    out[max_lag + 1] = same - (m - 1.0) * same_pairs / pairs
+    out[max_lag + 2] = nxt - (m - 1.0) * next_pairs / pairs
+
+    # Consecutive blocks of centred tags; disjoint cards covary by -var / (m - 1) in a random shoe.
+    blocks = m // ROUND_CARDS
+    if blocks < 2: return
+    mean = s / m
+    var = q / m - mean * mean
+    prev_block = 0.0
+    cross = sq = 0.0
+    for j in range(blocks):
+        block = 0.0
+        for t in range(j * ROUND_CARDS, (j + 1) * ROUND_CARDS): block += HILO_TAGS[row[t] % 13] - mean
+        if j > 0:
+            cross += prev_block * block
+            sq += prev_block * prev_block
+        prev_block = block
+    out[max_lag + 3] = cross + (blocks - 1) * ROUND_CARDS * ROUND_CARDS * var / (m - 1.0)
+    out[max_lag + 5] = sq
+    out[max_lag + 6] = blocks - 1.0
+
+@njit(cache=True)
+def _carryover_stat(prev: np.ndarray, prev_m: int, row: np.ndarray, m: int, pair_counts: np.ndarray, card_counts: np.ndarray) -> float:
+    """
+    Pairs of cards adjacent (either way round) in the previous shoe found
+    within CARRYOVER_LAGS cards in this one, minus their expected number
+    given this shoe's cards. pair_counts (52, 52) and card_counts (52,) are
+    zeroed scratch buffers and are left zeroed.
+    """
+    for t in range(m): card_counts[row[t]] += 1.0
+    expected_pairs = 0.0
+    for t in range(prev_m - 1):
+        a, b = prev[t], prev[t + 1]
+        pair_counts[a, b] += 1.0
+        pair_counts[b, a] += 1.0
+        same = card_counts[a] if a == b else 0.0
+        expected_pairs += 2.0 * (card_counts[a] * card_counts[b] - same)
+    observed = 0.0
+    positions = 0.0
+    for k in range(1, CARRYOVER_LAGS + 1):
+        positions += max(m - k, 0)
+        for t in range(m - k): observed += pair_counts[row[t], row[t + k]]
+    for t in range(prev_m - 1):
+        pair_counts[prev[t], prev[t + 1]] = 0.0
+        pair_counts[prev[t + 1], prev[t]] = 0.0
+    for t in range(m): card_counts[row[t]] = 0.0
+    if m < 2: return 0.0
+    return observed - positions * expected_pairs / (m * (m - 1.0))
+
+@njit(parallel=True)
+def shoe_statistics(cards: np.ndarray, carry: np.ndarray, follows: np.ndarray, max_lag: int) -> np.ndarray:
+    """
+    Per-shoe statistics (columns of stat_keys(max_lag)) for a batch of
+    recorded shoes. follows[i] is True when shoe i is the next shoe of the
+    same sequence as the one before it, which for i = 0 is `carry` (the last
+    shoe of the previous batch); carryover is NaN for shoes that follow none.
+    """
+    n_shoes = cards.shape[0]
+    n_stats = max_lag + 7
+    out = np.zeros((n_shoes, n_stats))
+    n_blocks = num_blocks(n_shoes, PATHS_PER_BLOCK)
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            pair_counts = np.zeros((52, 52))
+            card_counts = np.zeros(52)
+            rank_counts = np.zeros(13)
+            for i in range((n_shoes * b) // n_blocks, (n_shoes * (b + 1)) // n_blocks):
+                row = cards[i]
+                m = _shoe_length(row)
+                _within_shoe_stats(row, m, max_lag, rank_counts, out[i])
+                if not follows[i]:
+                    out[i, max_lag + 4] = np.nan
+                    continue
+                prev = carry if i == 0 else cards[i - 1]
+                out[i, max_lag + 4] = _carryover_stat(prev, _shoe_length(prev), row, m, pair_counts, card_counts)
+    return out
+
+# --- Streaming analysis ---
+
+class ShuffleTestAccumulator:
+    """Per-statistic sums, sums of squares and shoe counts over streamed batches."""
+    def __init__(self, max_lag: int = MAX_LAG):
+        self.keys = stat_keys(max_lag)
+        self.sums = np.zeros(len(self.keys))
+        self.sums_sq = np.zeros(len(self.keys))
+        self.shoes = np.zeros(len(self.keys), dtype=np.int64)
+
+    def add(self, stats: np.ndarray) -> None:
+        valid = ~np.isnan(stats)
+        values = np.where(valid, stats, 0.0)
+        self.sums += values.sum(axis=0)
+        self.sums_sq += (values * values).sum(axis=0)
+        self.shoes += valid.sum(axis=0)
+
+    def _spread(self, key: str) -> tuple[int, float, float]:
+        """Shoe count, mean and sample standard deviation of a statistic."""
+        k = self.keys.index(key)
+        n = int(self.shoes[k])
+        if n < 2: return n, 0.0, 0.0
+        mean = self.sums[k] / n
+        return n, mean, math.sqrt(max(self.sums_sq[k] / n - mean * mean, 0.0) * n / (n - 1))
+
+    def test(self, key: str) -> dict:
+        """z score and two-sided p-value of a zero-mean statistic, normalised by its observed spread."""
+        n, mean, sd = self._spread(key)
+        if n < 2: return {"shoes": n, "mean": 0.0, "z": 0.0, "p_value": 1.0}
+        z = mean / (sd / math.sqrt(n)) if sd > 0 else 0.0
+        return {"shoes": n, "mean": float(mean), "z": float(z), "p_value": math.erfc(abs(z) / math.sqrt(2.0))}
+
+    def exploitable_edge(self, alpha: float = 0.01) -> dict:
+        """
+        Excess regression slope of a block's centred tag sum on the previous
+        block's and its standard error, the standard deviation of the
+        predicted shift in true count for the next round, and the expected
+        edge of a player who raises only when that shift is favourable
+        (normal approximation). The shift and edge are 0 unless the
+        block_serial test rejects at `alpha`: the edge uses |slope|, so
+        sampling noise alone would otherwise read as a positive edge.
+        expected_edge_se is the standard error of the ungated edge.
+        """
+        cross, sq, pairs = (self.sums[self.keys.index(key)] for key in ("block_serial", "block_sq", "block_pairs"))
+        if sq <= 0 or pairs <= 0:
+            return {"excess_slope": 0.0, "slope_se": 0.0, "significant": False,
+                    "true_count_shift_sd": 0.0, "expected_edge": 0.0, "expected_edge_se": 0.0}
+        n, _, sd = self._spread("block_serial")
+        slope = float(cross / sq)
+        slope_se = float(sd * math.sqrt(n) / sq)
+        edge_per_slope = EDGE_PER_TRUE_COUNT * math.sqrt(sq / pairs) * 52.0 / ROUND_CARDS / math.sqrt(2.0 * math.pi)
+        significant = bool(self.test("block_serial")["p_value"] < alpha)
+        shift_sd = abs(slope) * math.sqrt(sq / pairs) * 52.0 / ROUND_CARDS if significant else 0.0
+        return {"excess_slope": slope, "slope_se": slope_se, "significant": significant,
+                "true_count_shift_sd": shift_sd,
+                "expected_edge": edge_per_slope * abs(slope) if significant else 0.0,
+                "expected_edge_se": edge_per_slope * slope_se}
+
+def analyze_history(path: str, batch_shoes: int = 100_000, max_lag: int = MAX_LAG, alpha: float = 0.01) -> dict:
+    """
+    Runs every test over a shoe history file, batch by batch. Reports each
+    test's z score and p-value with a flag for p < alpha, and the expected
+    exploitable edge, which is 0 unless block_serial rejects.
+    """
+    accumulator = ShuffleTestAccumulator(max_lag)
+    carry, carry_sequence = None, None
+    for sequence_ids, cards in read_shoe_history(path, batch_shoes):
+        follows = np.zeros(cards.shape[0], dtype=np.bool_)
+        follows[1:] = sequence_ids[1:] == sequence_ids[:-1]
+        follows[0] = carry is not None and sequence_ids[0] == carry_sequence
+        stats = shoe_statistics(cards, cards[0] if carry is None else carry, follows, max_lag)
+        accumulator.add(stats)
+        carry, carry_sequence = cards[-1].copy(), sequence_ids[-1]
+
+    tests = {}
+    for key in accumulator.keys:
+        if key in ("block_sq", "block_pairs"): continue
+        result = accumulator.test(key)
+        result["rejects"] = result["p_value"] < alpha
+        tests[key] = result
+    shoes = int(accumulator.shoes[0])
+    return {"shoes": shoes, "alpha": alpha, "tests": tests, "exploitable": accumulator.exploitable_edge(alpha)}
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Test recorded shoes for shuffle clumping.")
+    parser.add_argument("history", help="Shoe history file.")
+    parser.add_argument("--batch", type=int, default=100_000, help="Shoes read per batch.")
+    parser.add_argument("--max-lag", type=int, default=MAX_LAG)
+    parser.add_argument("--alpha", type=float, default=0.01)
+    parser.add_argument("--generate", action="store_true", help="First write a synthetic history to the file.")
+    parser.add_argument("--procedure", default="one_pass", help="Shuffle procedure for --generate.")
+    parser.add_argument("--decks", type=int, default=6)
+    parser.add_argument("--sequences", type=int, default=100)
+    parser.add_argument("--shoes", type=int, default=100, help="Shoes per sequence for --generate.")
+    parser.add_argument("--penetration", type=float, default=0.75)
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args(argv)
+
+    if args.generate:
+        generate_history(args.history, args.procedure, args.decks, args.sequences, args.shoes, args.penetration, args.seed)
+    print(json.dumps(analyze_history(args.history, args.batch, args.max_lag, args.alpha), indent=2))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,498 @@
+"""
+Physical shuffle models and shuffle tracking. The count-based Shoe only knows
+how many of each card are left; here a shoe is an ordered array of card
+indices (suit * 13 + rank, index 0 dealt first), so the order the cards come
+out in depends on how the previous shoe was shuffled.
+
+A shuffle procedure is a sequence of in-place operations on the stack:
+
+  random   perfectly random (Fisher-Yates), the baseline
+  riffle   Gilbert-Shannon-Reeds riffle; param = cards per grab from each half
+           (zone shuffle), 0 riffles the two halves whole
+  strip    packets of about param cards stripped off the top onto a new pile
+  plug     about param of the stack taken from the bottom and plugged in at a
+           random depth
+  box      the stack cut into param equal boxes stacked in reverse order
+  cut      the stack cut at a point in [param, 1 - param] of its depth
+
+and is written as a name from SHUFFLE_PROCEDURES or as "op:param,op:param".
+
+A tracker watches the discards, picks the richest run of slug_cards seen
+cards (lowest Hi-Lo tag sum) in the stack that is about to be shuffled, and
+follows the densest part of it through the shuffle to within zone_cards,
+losing it if the shuffle spreads it too thin. While the slug is due in
+the next lookahead cards they bet slug_bet units instead of one; with
+cut_to_slug they also take the cut and cut the slug to the top. Following a
+slug with a random shuffle should gain nothing, which makes "random" the
+control for any other procedure.
+
+    python shuffle_tracking.py --procedure casino --decks 6 --bet 8
+    python shuffle_tracking.py --procedure "riffle:26,strip:10,riffle:26,cut:0.2" --cut-to-slug
+"""
+from __future__ import annotations
+import argparse
+import json
+import math
+import random
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+from numba_utils import HILO_TAGS, add_card_to_hand, hand_state_total, rng_stream_state, rng_uniform
+from simulator import _resolve_outcome, _should_double, _should_split, _should_stand
+
+# Operations of a shuffle program, one (op code, param) row per step.
+SHUFFLE_OPS = ("random", "riffle", "strip", "plug", "box", "cut")
+OP_RANDOM, OP_RIFFLE, OP_STRIP, OP_PLUG, OP_BOX, OP_CUT = range(len(SHUFFLE_OPS))
+
+SHUFFLE_PROCEDURES = {
+    "random": "random:0,cut:0.2",
+    "one_pass": "riffle:26,cut:0.2",
+    "casino": "riffle:26,strip:10,riffle:26,cut:0.2",
+    "plug_box": "plug:0.3,riffle:26,box:4,cut:0.2",
+    "full_riffles": "riffle:0,riffle:0,riffle:0,strip:8,riffle:0,cut:0.2",
+}
+
+# A tracked card carries this offset in the ordered shoe, so it moves with the card through every shuffle.
+SLUG_MARK = 52
+# The tracker follows the densest SLUG_CORE of the slug and gives up on a slug spread over more than
+# SLUG_LOST_SPREAD times its own length.
+SLUG_CORE = 0.8
+SLUG_LOST_SPREAD = 3.0
+
+def parse_procedure(spec: str) -> np.ndarray:
+    """
+    A shuffle program for a procedure name or an "op:param,..." string, as
+    rows of (op code, param).
+
+    Raises:
+        ValueError: If an operation is unknown or has no parameter.
+    """
+    spec = SHUFFLE_PROCEDURES.get(spec, spec)
+    rows = []
+    for step in spec.split(","):
+        op, _, param = step.strip().partition(":")
+        if op not in SHUFFLE_OPS or not param:
+            raise ValueError(f"Bad shuffle step '{step}'; expected op:param with op in {SHUFFLE_OPS}.")
+        rows.append((SHUFFLE_OPS.index(op), float(param)))
+    return np.array(rows, dtype=np.float64).reshape(-1, 2)
+
+@njit(cache=True)
+def ordered_shoe(decks: int) -> np.ndarray:
+    """A shoe of `decks` decks in new-deck order, one card index per slot."""
+    deck = np.empty(decks * 52, dtype=np.int64)
+    for i in range(deck.shape[0]): deck[i] = i % 52
+    return deck
+
+# --- Shuffle kernels ---
+# Each operation reads the stack from `cards`, writes the result to the
+# same-sized buffer `buf` and copies it back, so a shoe allocates nothing per
+# shuffle.
+
+@njit(cache=True)
+def _binomial_half(n: int, rng: np.ndarray) -> int:
+    """A Binomial(n, 1/2) draw: the size of one half of an n-card cut."""
+    k = 0
+    for _ in range(n):
+        if rng_uniform(rng) < 0.5: k += 1
+    return k
+
+@njit(cache=True)
+def _interleave(src: np.ndarray, a_lo: int, a_n: int, b_lo: int, b_n: int, dst: np.ndarray, d_lo: int, rng: np.ndarray) -> None:
+    """GSR riffle of two packets: each card drops from a packet with probability proportional to its size."""
+    i = j = 0
+    for k in range(d_lo, d_lo + a_n + b_n):
+        if j >= b_n or (i < a_n and rng_uniform(rng) * (a_n - i + b_n - j) < a_n - i):
+            dst[k] = src[a_lo + i]
+            i += 1
+        else:
+            dst[k] = src[b_lo + j]
+            j += 1
+
+@njit(cache=True)
+def _riffle(cards: np.ndarray, buf: np.ndarray, grab: int, rng: np.ndarray) -> None:
+    """
+    Splits the stack into two halves and riffles grabs of about `grab` cards
+    from the top of each, stacking each riffled pair on a new pile (so the first
+    pair ends at the bottom). grab <= 0 riffles the halves whole.
+    """
+    n = cards.shape[0]
+    h = _binomial_half(n, rng)
+    if grab <= 0:
+        _interleave(cards, 0, h, h, n - h, buf, 0, rng)
+    else:
+        a, b, end = 0, h, n
+        while a < h or b < n:
+            ga = min(h - a, _binomial_half(2 * grab, rng))
+            gb = min(n - b, _binomial_half(2 * grab, rng))
+            if ga + gb == 0:
+                if a < h: ga = 1
+                else: gb = 1
+            end -= ga + gb
+            _interleave(cards, a, ga, b, gb, buf, end, rng)
+            a += ga
+            b += gb
+    cards[:] = buf
+
+@njit(cache=True)
+def _strip(cards: np.ndarray, buf: np.ndarray, mean_packet: float, rng: np.ndarray) -> None:
+    """Strips packets of 1 .. 2 * mean_packet - 1 cards off the top onto a new pile, reversing their order."""
+    n = cards.shape[0]
+    span = max(2.0 * mean_packet - 1.0, 1.0)
+    i, end = 0, n
+    while i < n:
+        size = min(n - i, 1 + int(rng_uniform(rng) * span))
+        end -= size
+        buf[end:end + size] = cards[i:i + size]
+        i += size
+    cards[:] = buf
+
+@njit(cache=True)
+def _plug(cards: np.ndarray, buf: np.ndarray, fraction: float, rng: np.ndarray) -> None:
+    """Plugs 0.75 .. 1.25 times `fraction` of the stack from the bottom in at a uniformly random depth."""
+    n = cards.shape[0]
+    m = min(n, int(round(fraction * n * (0.75 + 0.5 * rng_uniform(rng)))))
+    q = int(rng_uniform(rng) * (n - m + 1))
+    buf[:q] = cards[:q]
+    buf[q:q + m] = cards[n - m:]
+    buf[q + m:] = cards[q:n - m]
+    cards[:] = buf
+
+@njit(cache=True)
+def _box(cards: np.ndarray, buf: np.ndarray, boxes: int) -> None:
+    """Cuts the stack into `boxes` equal packets and stacks them in reverse order."""
+    n = cards.shape[0]
+    boxes = max(boxes, 1)
+    for k in range(boxes):
+        lo, hi = (n * k) // boxes, (n * (k + 1)) // boxes
+        buf[n - hi:n - lo] = cards[lo:hi]
+    cards[:] = buf
+
+@njit(cache=True)
+def _cut(cards: np.ndarray, buf: np.ndarray, position: int) -> None:
+    """Moves the top `position` cards to the bottom."""
+    n = cards.shape[0]
+    buf[:n - position] = cards[position:]
+    buf[n - position:] = cards[:position]
+    cards[:] = buf
+
+@njit(cache=True)
+def _random_shuffle(cards: np.ndarray, rng: np.ndarray) -> None:
+    """Fisher-Yates shuffle of the whole stack, for a shoe's first shuffle."""
+    for i in range(cards.shape[0] - 1, 0, -1):
+        j = int(rng_uniform(rng) * (i + 1))
+        cards[i], cards[j] = cards[j], cards[i]
+
+@njit(cache=True)
+def apply_shuffle(cards: np.ndarray, buf: np.ndarray, program: np.ndarray, rng: np.ndarray, cut_at: int = -1) -> None:
+    """
+    Runs a shuffle program over the stack in place. A cut_at at or past the
+    shallowest allowed cut replaces the random position of every cut step
+    (capped at the deepest allowed cut); a shallower one cannot be honoured,
+    so the cut stays random.
+    """
+    n = cards.shape[0]
+    for k in range(program.shape[0]):
+        op, param = int(program[k, 0]), program[k, 1]
+        if op == OP_RANDOM: _random_shuffle(cards, rng)
+        elif op == OP_RIFFLE: _riffle(cards, buf, int(param), rng)
+        elif op == OP_STRIP: _strip(cards, buf, param, rng)
+        elif op == OP_PLUG: _plug(cards, buf, param, rng)
+        elif op == OP_BOX: _box(cards, buf, int(param))
+        elif op == OP_CUT:
+            lo, hi = int(param * n), n - int(param * n)
+            position = min(cut_at, hi) if cut_at >= lo else lo + int(rng_uniform(rng) * (hi - lo + 1))
+            _cut(cards, buf, position)
+
+# --- Ordered-shoe round ---
+
+@njit(cache=True)
+def _deal(deck: np.ndarray, cursor: np.ndarray) -> int:
+    """Next card index off the ordered shoe (slug mark removed), or -1 at its end."""
+    if cursor[0] >= deck.shape[0]: return -1
+    card = deck[cursor[0]] % SLUG_MARK
+    cursor[0] += 1
+    return card
+
+@njit(cache=True)
+def _play_ordered_hand(hard_total: int, aces: int, deck: np.ndarray, cursor: np.ndarray, dealer_up_rank: int) -> tuple[int, float]:
+    """simulator._play_single_hand for a two-card hand dealt from an ordered shoe."""
+    hand_val, is_soft = hand_state_total(hard_total, aces)
+    if _should_double(hand_val, is_soft, dealer_up_rank):
+        card = _deal(deck, cursor)
+        if card != -1: hard_total, aces = add_card_to_hand(hard_total, aces, card % 13)
+        return hand_state_total(hard_total, aces)[0], 2.0
+    while True:
+        total, is_soft = hand_state_total(hard_total, aces)
+        if total >= 21 or _should_stand(total, is_soft, dealer_up_rank): return total, 1.0
+        card = _deal(deck, cursor)
+        if card == -1: return total, 1.0
+        hard_total, aces = add_card_to_hand(hard_total, aces, card % 13)
+
+@njit(cache=True)
+def _play_ordered_round(deck: np.ndarray, cursor: np.ndarray, first_cards: np.ndarray, n_others: int) -> float:
+    """
+    One round from the ordered shoe with the player in the first seat and
+    n_others basic-strategy players after them. Cards go round the table
+    twice, dealer upcard after the first pass and hole card after the second.
+    Returns the player's main-bet outcome (0.0 if the shoe ran out).
+    """
+    seats = n_others + 1
+    for s in range(seats): first_cards[s, 0] = _deal(deck, cursor)
+    d1 = _deal(deck, cursor)
+    for s in range(seats): first_cards[s, 1] = _deal(deck, cursor)
+    d2 = _deal(deck, cursor)
+    if d2 == -1: return 0.0
+
+    d_rank = d1 % 13
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d2 % 13)
+    dealer_blackjack = hand_state_total(d_hard, d_aces)[0] == 21
+    r1, r2 = first_cards[0, 0] % 13, first_cards[0, 1] % 13
+    p_hard, p_aces = add_card_to_hand(0, 0, r1)
+    p_hard, p_aces = add_card_to_hand(p_hard, p_aces, r2)
+    player_blackjack = hand_state_total(p_hard, p_aces)[0] == 21
+    if dealer_blackjack: return 0.0 if player_blackjack else -1.0
+
+    t2, m2 = 0, 0.0
+    if player_blackjack:
+        t1, m1 = 21, 0.0
+    elif r1 == r2 and _should_split(r1, d_rank):
+        c1, c2 = _deal(deck, cursor), _deal(deck, cursor)
+        if c2 == -1: return 0.0
+        h_hard, h_aces = add_card_to_hand(0, 0, r1)
+        h_hard, h_aces = add_card_to_hand(h_hard, h_aces, c1 % 13)
+        t1, m1 = _play_ordered_hand(h_hard, h_aces, deck, cursor, d_rank)
+        h_hard, h_aces = add_card_to_hand(0, 0, r1)
+        h_hard, h_aces = add_card_to_hand(h_hard, h_aces, c2 % 13)
+        t2, m2 = _play_ordered_hand(h_hard, h_aces, deck, cursor, d_rank)
+    else:
+        t1, m1 = _play_ordered_hand(p_hard, p_aces, deck, cursor, d_rank)
+
+    for s in range(1, seats):
+        o_hard, o_aces = add_card_to_hand(0, 0, first_cards[s, 0] % 13)
+        o_hard, o_aces = add_card_to_hand(o_hard, o_aces, first_cards[s, 1] % 13)
+        _play_ordered_hand(o_hard, o_aces, deck, cursor, d_rank)
+
+    if player_blackjack and n_others == 0: return 1.5
+    while hand_state_total(d_hard, d_aces)[0] < 17:
+        card = _deal(deck, cursor)
+        if card == -1: break
+        d_hard, d_aces = add_card_to_hand(d_hard, d_aces, card % 13)
+    if player_blackjack: return 1.5
+    dealer_final = hand_state_total(d_hard, d_aces)[0]
+    outcome = _resolve_outcome(t1, dealer_final, m1)
+    if m2 > 0.0: outcome += _resolve_outcome(t2, dealer_final, m2)
+    return outcome
+
+# --- Tracking ---
+
+@njit(cache=True)
+def _collect_discards(deck: np.ndarray, buf: np.ndarray, dealt: int) -> None:
+    """
+    Rebuilds the stack to be shuffled: the undealt cards on top of the
+    discards, which lie in reverse dealing order. Old slug marks are cleared.
+    """
+    n = deck.shape[0]
+    undealt = n - dealt
+    for i in range(undealt): buf[i] = deck[dealt + i] % SLUG_MARK
+    for i in range(dealt): buf[undealt + i] = deck[dealt - 1 - i] % SLUG_MARK
+    deck[:] = buf
+
+@njit(cache=True)
+def _mark_slug(deck: np.ndarray, seen_from: int, slug_cards: int) -> float:
+    """
+    Marks the run of slug_cards seen cards (from seen_from on) with the lowest
+    Hi-Lo tag sum, and returns its richness as high cards minus low cards per
+    deck. Returns NaN, marking nothing, if fewer cards were seen.
+    """
+    n = deck.shape[0]
+    if n - seen_from < slug_cards or slug_cards <= 0: return np.nan
+    window = 0.0
+    for i in range(seen_from, seen_from + slug_cards): window += HILO_TAGS[deck[i] % 13]
+    best, best_lo = window, seen_from
+    for lo in range(seen_from + 1, n - slug_cards + 1):
+        window += HILO_TAGS[deck[lo + slug_cards - 1] % 13] - HILO_TAGS[deck[lo - 1] % 13]
+        if window < best: best, best_lo = window, lo
+    for i in range(best_lo, best_lo + slug_cards): deck[i] += SLUG_MARK
+    return -best * 52.0 / slug_cards
+
+@njit(cache=True)
+def _slug_span(deck: np.ndarray, positions: np.ndarray, zone_cards: int) -> tuple[int, int]:
+    """
+    The tracker's estimate of where the slug lies: the shortest run of the
+    stack holding SLUG_CORE of its cards, widened to whole zones of
+    zone_cards. positions is a scratch buffer with one slot per slug card.
+    Returns (-1, -1) when nothing is marked or the slug has spread over more
+    than SLUG_LOST_SPREAD times its length, where a tracker loses it.
+    """
+    m = 0
+    for i in range(deck.shape[0]):
+        if deck[i] >= SLUG_MARK and m < positions.shape[0]:
+            positions[m] = i
+            m += 1
+    if m == 0: return -1, -1
+    core = max(1, int(math.ceil(SLUG_CORE * m)))
+    lo, hi = positions[0], positions[core - 1]
+    for k in range(1, m - core + 1):
+        if positions[k + core - 1] - positions[k] < hi - lo: lo, hi = positions[k], positions[k + core - 1]
+    zone = max(zone_cards, 1)
+    lo, hi = (lo // zone) * zone, (hi // zone + 1) * zone
+    if hi - lo > SLUG_LOST_SPREAD * m: return -1, -1
+    return lo, hi
+
+@njit(parallel=True)
+def simulate_tracking(
+    decks: int, n_sequences: int, n_shoes: int, seed: int, program: np.ndarray, min_cards: int,
+    slug_cards: int, zone_cards: int, lookahead: int, slug_bet: float, cut_to_slug: bool, n_others: int
+) -> tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Plays n_sequences independent sequences of n_shoes consecutive shoes,
+    each shuffled from the previous one's discards by the program, after a
+    randomly shuffled warm-up shoe that is not recorded. Rounds start while
+    more than min_cards remain. Returns per sequence the rounds played, the
+    units won betting one unit flat, the units won by the tracker, the rounds
+    bet at slug_bet, the flat units won in those rounds and the summed slug
+    richness (see _mark_slug) of the shoes that had a slug.
+    """
+    n = decks * 52
+    rounds = np.zeros(n_sequences, dtype=np.int64)
+    flat = np.zeros(n_sequences)
+    tracked = np.zeros(n_sequences)
+    slug_rounds = np.zeros(n_sequences, dtype=np.int64)
+    slug_flat = np.zeros(n_sequences)
+    richness = np.zeros(n_sequences)
+    cut = n - max(min_cards, 1)
+
+    with parallel_chunksize(1):
+        for q in prange(n_sequences):
+            rng = np.zeros(1, dtype=np.uint64)
+            rng[0] = rng_stream_state(seed, q)
+            cursor = np.zeros(1, dtype=np.int64)
+            first_cards = np.zeros((n_others + 1, 2), dtype=np.int64)
+            deck = ordered_shoe(decks)
+            buf = np.zeros(n, dtype=np.int64)
+            positions = np.zeros(max(slug_cards, 1), dtype=np.int64)
+            _random_shuffle(deck, rng)
+            lo, hi = -1, -1
+
+            for shoe_no in range(n_shoes + 1):
+                cursor[0] = 0
+                while cursor[0] < cut:
+                    start = cursor[0]
+                    big = lo >= 0 and lo < start + lookahead and hi > start
+                    outcome = _play_ordered_round(deck, cursor, first_cards, n_others)
+                    if shoe_no == 0: continue
+                    rounds[q] += 1
+                    flat[q] += outcome
+                    if big:
+                        tracked[q] += slug_bet * outcome
+                        slug_rounds[q] += 1
+                        slug_flat[q] += outcome
+                    else:
+                        tracked[q] += outcome
+
+                dealt = cursor[0]
+                _collect_discards(deck, buf, dealt)
+                slug = _mark_slug(deck, n - dealt, slug_cards)
+                if not np.isnan(slug) and shoe_no < n_shoes: richness[q] += slug
+                cut_at = -1
+                if cut_to_slug:
+                    # Every step but the cut runs first, so the tracker cuts where the slug ended up.
+                    apply_shuffle(deck, buf, program[:-1], rng)
+                    cut_at = _slug_span(deck, positions, zone_cards)[0]
+                    apply_shuffle(deck, buf, program[-1:], rng, cut_at)
+                else:
+                    apply_shuffle(deck, buf, program, rng)
+                lo, hi = _slug_span(deck, positions, zone_cards)
+    return rounds, flat, tracked, slug_rounds, slug_flat, richness
+
+def _ratio(won: np.ndarray, rounds: np.ndarray) -> tuple[float, float]:
+    """Units won per round and its standard error across independent sequences."""
+    total = rounds.sum()
+    if total == 0: return 0.0, 0.0
+    rate = won.sum() / total
+    if won.shape[0] < 2: return float(rate), 0.0
+    resid = (won - rate * rounds) / rounds.mean()
+    return float(rate), float(resid.std(ddof=1) / math.sqrt(won.shape[0]))
+
+def simulate_shuffle_tracking(
+    procedure: str = "casino",
+    decks: int = 6,
+    penetration: float = 0.75,
+    n_sequences: int = 2_000,
+    n_shoes: int = 20,
+    slug_cards: int = 52,
+    zone_cards: int = 26,
+    lookahead: int = 8,
+    slug_bet: float = 8.0,
+    cut_to_slug: bool = False,
+    others: int = 0,
+    seed: int | None = None
+) -> dict:
+    """
+    Simulates a slug tracker against a shuffle procedure (a SHUFFLE_PROCEDURES
+    name or an "op:param,..." string). Reports the flat bettor's EV per round,
+    the tracker's win per round and per 100 rounds, the share of rounds bet at
+    slug_bet, the flat EV inside and outside slug rounds and the mean richness
+    of the slugs chosen. Compare with procedure="random" for the no-tracking
+    baseline.
+
+    Raises:
+        ValueError: If the procedure cannot be parsed or a cut_to_slug
+            procedure does not end with a cut.
+    """
+    if not 0.0 < penetration < 1.0:
+        raise ValueError("Penetration must be in (0, 1).")
+    program = parse_procedure(procedure)
+    if cut_to_slug and int(program[-1, 0]) != OP_CUT:
+        raise ValueError("Cutting to the slug needs a procedure that ends with a cut.")
+    min_cards = int(round(decks * 52 * (1.0 - penetration)))
+    seed = random.getrandbits(63) if seed is None else seed
+
+    rounds, flat, tracked, slug_rounds, slug_flat, richness = simulate_tracking(
+        decks, n_sequences, n_shoes, seed, program, min_cards, slug_cards, zone_cards,
+        lookahead, slug_bet, cut_to_slug, others)
+
+    flat_ev, flat_se = _ratio(flat, rounds)
+    win, win_se = _ratio(tracked, rounds)
+    slug_ev, slug_se = _ratio(slug_flat, slug_rounds)
+    other_ev, other_se = _ratio(flat - slug_flat, rounds - slug_rounds)
+    total_rounds = int(rounds.sum())
+    slug_share = float(slug_rounds.sum() / total_rounds) if total_rounds else 0.0
+    return {
+        "procedure": SHUFFLE_PROCEDURES.get(procedure, procedure), "decks": decks, "sequences": n_sequences,
+        "shoes_per_sequence": n_shoes, "rounds": total_rounds, "seed": seed,
+        "flat_ev_per_round": flat_ev, "flat_std_error": flat_se,
+        "tracker_win_per_round": win, "tracker_std_error": win_se,
+        "tracker_win_per_100_rounds": 100.0 * win,
+        "tracker_win_per_unit_bet": win / (1.0 + slug_share * (slug_bet - 1.0)),
+        "slug_round_share": slug_share,
+        "ev_in_slug_rounds": slug_ev, "ev_in_slug_rounds_std_error": slug_se,
+        "ev_outside_slug_rounds": other_ev, "ev_outside_slug_rounds_std_error": other_se,
+        "mean_slug_richness": float(richness.sum() / (n_sequences * n_shoes)),
+    }
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Simulate slug tracking against physical shuffle procedures.")
+    parser.add_argument("--procedure", default="casino",
+                        help=f"One of {sorted(SHUFFLE_PROCEDURES)} or steps like 'riffle:26,strip:10,cut:0.2'.")
+    parser.add_argument("--decks", type=int, default=6)
+    parser.add_argument("--penetration", type=float, default=0.75)
+    parser.add_argument("--sequences", type=int, default=2_000)
+    parser.add_argument("--shoes", type=int, default=20, help="Consecutive shoes per sequence.")
+    parser.add_argument("--slug", type=int, default=52, help="Cards in the tracked slug.")
+    parser.add_argument("--zone", type=int, default=26, help="Resolution of the tracker's slug location, in cards.")
+    parser.add_argument("--lookahead", type=int, default=8, help="Raise the bet when the slug is this many cards away.")
+    parser.add_argument("--bet", type=float, default=8.0, help="Units bet while the slug is due.")
+    parser.add_argument("--cut-to-slug", action="store_true", help="The tracker takes the cut and cuts the slug to the top.")
+    parser.add_argument("--others", type=int, default=0, help="Basic-strategy players after the tracker.")
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args(argv)
+
+    print(json.dumps(simulate_shuffle_tracking(
+        args.procedure, args.decks, args.penetration, args.sequences, args.shoes, args.slug, args.zone,
+        args.lookahead, args.bet, args.cut_to_slug, args.others, args.seed), indent=2))
+
+if __name__ == "__main__":
+    main()
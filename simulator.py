@@ -4,18 +4,106 @@ to calculate the Expected Value (EV) of the main bet and various side bets.
 This version has been stabilized and now includes logic for splitting pairs.
 """
 from __future__ import annotations
+import json
+import os
+import random
+import threading
+from contextlib import contextmanager, nullcontext
+import numba
 import numpy as np
-from numba import njit, prange
-from concurrent.futures import ThreadPoolExecutor
+from numba import njit, prange, get_num_threads, get_thread_id, parallel_chunksize
 
 from numba_utils import (
-    get_hand_total,
-    draw_card,
-    evaluate_21plus3_numba,
-    evaluate_perfect_pairs_numba,
-    evaluate_hot3_numba,
+    get_card_value_numba,
+    add_card_to_hand,
+    hand_state_total,
+    hilo_true_count,
+    make_scratch_shoe,
+    make_undo_log,
+    UNDO_CAPACITY,
+    draw_scratch_card_rng,
+    restore_scratch_shoe,
+    rng_stream_state,
+    evaluate_21plus3_cards,
+    evaluate_perfect_pairs_cards,
+    evaluate_hot3_cards,
 )
 
+# Column order of the per-round outcome vector and of the accumulators. main_ev
+# includes surrendered hands at -0.5; surrender_gain_ev is what surrendering won
+# over playing those hands out, and insurance_ev / even_money_ev are the
+# insurance bets taken without and with a player blackjack.
+BET_KEYS = ("main_ev", "bust_ev", "21+3_ev", "perfect_pairs_ev", "hot3_ev",
+            "surrender_gain_ev", "insurance_ev", "even_money_ev")
+NUM_BETS = len(BET_KEYS)
+BET_SURRENDER_GAIN, BET_INSURANCE, BET_EVEN_MONEY = 5, 6, 7
+
+# Surrender rules: none, late (after the dealer checks for blackjack) or early (before).
+SURRENDER_RULES = ("none", "late", "early")
+SURRENDER_NONE, SURRENDER_LATE, SURRENDER_EARLY = range(len(SURRENDER_RULES))
+
+# Optional in-kernel diagnostic counters. Kernels take `diag` as either None or an
+# int64 array of NUM_DIAG counters; Numba compiles a separate specialization for
+# None in which every counter update is pruned, so the default path pays nothing.
+DIAG_KEYS = (
+    "rounds", "truncated_rounds", "empty_draws", "cards_consumed", "blackjacks", "dealer_blackjacks",
+    "splits", "doubles", "player_hits", "player_busts", "dealer_draws", "dealer_busts",
+    "surrenders", "insurances",
+)
+NUM_DIAG = len(DIAG_KEYS)
+(DIAG_ROUNDS, DIAG_TRUNCATED, DIAG_EMPTY_DRAWS, DIAG_CARDS, DIAG_BLACKJACKS, DIAG_DEALER_BLACKJACKS,
+ DIAG_SPLITS, DIAG_DOUBLES, DIAG_PLAYER_HITS, DIAG_PLAYER_BUSTS, DIAG_DEALER_DRAWS, DIAG_DEALER_BUSTS,
+ DIAG_SURRENDERS, DIAG_INSURANCES) = range(NUM_DIAG)
+
+# Rounds per work block. The parallel kernels split a range into many small blocks
+# that idle threads claim one at a time (chunk size 1) instead of one static slice
+# per thread, because round cost varies a lot (blackjacks end after four cards,
+# splits play three hands) and static slices leave threads idle at the tail.
+# Each block has its own accumulator and blocks are reduced in index order, so
+# totals do not depend on which thread ran which block.
+# Kernels that open a parallel_chunksize block, and num_blocks (which reads the
+# thread count at run time), are compiled without cache=True: Numba cannot cache
+# them and fails in the cache save if asked to.
+BLOCK_ROUNDS = 2_048
+_MAX_THREADS = numba.config.NUMBA_NUM_THREADS
+
+# Strategies for other players at the table (see _play_seat).
+SEAT_STRATEGIES = ("basic", "never_bust", "mimic_dealer")
+SEAT_BASIC, SEAT_NEVER_BUST, SEAT_MIMIC_DEALER = range(len(SEAT_STRATEGIES))
+
+def seat_codes(seats) -> np.ndarray:
+    """
+    Strategy codes for a group of other players: an int gives that many basic
+    strategy players, otherwise a sequence of SEAT_STRATEGIES names.
+    """
+    if isinstance(seats, int): return np.full(seats, SEAT_BASIC, dtype=np.int64)
+    unknown = [name for name in seats if name not in SEAT_STRATEGIES]
+    if unknown: raise ValueError(f"Unknown seat strategies {unknown}; expected {SEAT_STRATEGIES}.")
+    return np.array([SEAT_STRATEGIES.index(name) for name in seats], dtype=np.int64)
+
+@njit
+def num_blocks(rounds: int, block_rounds: int) -> int:
+    """Work blocks for `rounds` rounds; block_rounds <= 0 gives one static block per thread."""
+    threads = get_num_threads()
+    if block_rounds <= 0: return min(rounds, threads)
+    return min(rounds, max(threads, (rounds + block_rounds - 1) // block_rounds))
+
+@njit(cache=True)
+def reduce_blocks(partial: np.ndarray) -> np.ndarray:
+    """Sums an (n_blocks, 2, k) array of per-block accumulators in block order into (2, k)."""
+    totals = np.zeros((2, partial.shape[2]), dtype=np.float64)
+    for b in range(partial.shape[0]):
+        for k in range(partial.shape[2]):
+            totals[0, k] += partial[b, 0, k]
+            totals[1, k] += partial[b, 1, k]
+    return totals
+
+@njit(cache=True)
+def _diag_add(diag, counter: int, n: int = 1) -> None:
+    """Bumps a diagnostic counter; compiles to nothing when diag is None."""
+    if diag is not None:
+        diag[counter] += n
+
 @njit(cache=True)
 def _resolve_outcome(player_total: int, dealer_total: int, bet_multiplier: float) -> float:
     """Compares final totals and returns the bet outcome."""
@@ -25,141 +113,642 @@ def _resolve_outcome(player_total: int, dealer_total: int, bet_multiplier: float
     return 0.0
 
 @njit(cache=True)
-def _play_single_hand(hand: np.ndarray, temp_shoe: np.ndarray, dealer_up_rank: int) -> tuple[int, float]:
+def _should_double(hand_val: int, is_soft: bool, dealer_up_rank: int) -> bool:
+    """Simplified doubling strategy for a two-card hand, by the dealer's upcard rank index."""
+    if is_soft: return hand_val in (17, 18) and dealer_up_rank in (2,3,4,5)
+    if hand_val == 11: return True
+    if hand_val == 10 and dealer_up_rank <= 8: return True
+    return hand_val == 9 and dealer_up_rank in (2,3,4,5)
+
+@njit(cache=True)
+def _should_stand(player_total: int, is_soft: bool, dealer_up_rank: int) -> bool:
+    """Simplified standing strategy below 21, by the dealer's upcard rank index."""
+    if is_soft: return player_total >= 19 or (player_total == 18 and dealer_up_rank <= 7)
+    if player_total >= 17: return True
+    if player_total >= 13 and dealer_up_rank <= 5: return True
+    return player_total == 12 and dealer_up_rank in (3,4,5)
+
+@njit(cache=True)
+def _play_single_hand(
+    hard_total: int, aces: int, n_cards: int, temp_shoe: np.ndarray, undo_log: np.ndarray,
+    dealer_up_rank: int, rng: np.ndarray, diag
+) -> tuple[int, float]:
     """
     Plays a single player hand (post-split or initial) according to basic strategy.
+    The hand is given as its incremental state (hard total, aces, card count).
     Returns the final hand total and the bet multiplier.
     """
-    if len(hand) == 2:
-        hand_val, is_soft = get_hand_total(hand)
-        do_double = False
-        if is_soft:
-            if hand_val in (17, 18) and dealer_up_rank in (2,3,4,5): do_double = True
-        else:
-            if hand_val == 11: do_double = True
-            if hand_val == 10 and dealer_up_rank <= 8: do_double = True
-            if hand_val == 9 and dealer_up_rank in (2,3,4,5): do_double = True
-        
-        if do_double:
-            card_idx = draw_card(temp_shoe)
-            if card_idx != -1: hand = np.append(hand, card_idx % 13)
-            final_total, _ = get_hand_total(hand)
+    if n_cards == 2:
+        hand_val, is_soft = hand_state_total(hard_total, aces)
+        if _should_double(hand_val, is_soft, dealer_up_rank):
+            _diag_add(diag, DIAG_DOUBLES)
+            card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+            if card_idx != -1: hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+            else: _diag_add(diag, DIAG_EMPTY_DRAWS)
+            final_total, _ = hand_state_total(hard_total, aces)
             return final_total, 2.0
 
     while True:
-        player_total, is_soft = get_hand_total(hand)
-        if player_total >= 21: return player_total, 1.0
+        player_total, is_soft = hand_state_total(hard_total, aces)
+        if player_total >= 21 or _should_stand(player_total, is_soft, dealer_up_rank): return player_total, 1.0
 
-        stand = False
-        if is_soft:
-            if player_total >= 19: stand = True
-            if player_total == 18 and dealer_up_rank <= 7: stand = True
-        else:
-            if player_total >= 17: stand = True
-            if player_total >= 13 and dealer_up_rank <= 5: stand = True
-            if player_total == 12 and dealer_up_rank in (3,4,5): stand = True
-        
-        if stand: return player_total, 1.0
-
-        card_idx = draw_card(temp_shoe)
-        if card_idx == -1: return player_total, 1.0
-        hand = np.append(hand, card_idx % 13)
-
-@njit(parallel=True, cache=True)
-def simulate_chunk(shoe_counts: np.ndarray, rounds: int) -> np.ndarray:
-    """
-    Runs a chunk of simulations in parallel, now with logic to handle one split.
-    """
-    np.random.seed(np.random.randint(0, 1_000_000))
-    results = np.zeros((rounds, 5), dtype=np.float64)
-
-    for i in prange(rounds):
-        temp_shoe = shoe_counts.copy()
-        
-        p1_idx, p2_idx, d1_idx = draw_card(temp_shoe), draw_card(temp_shoe), draw_card(temp_shoe)
-        if -1 in (p1_idx, p2_idx, d1_idx): continue
-
-        p_ranks = np.array([p1_idx % 13, p2_idx % 13])
-        p_suits = np.array([p1_idx // 13, p2_idx // 13])
-        d_rank, d_suit = d1_idx % 13, d1_idx // 13
-
-        results[i, 2] = evaluate_21plus3_numba(p_ranks, d_rank, p_suits, d_suit)
-        results[i, 3] = evaluate_perfect_pairs_numba(p_ranks, p_suits)
-        results[i, 4] = evaluate_hot3_numba(p_ranks, d_rank)
-
-        player_total, _ = get_hand_total(p_ranks)
-        d_hole_idx = draw_card(temp_shoe)
-        if d_hole_idx == -1: continue
-        
-        dealer_hand = np.array([d_rank, d_hole_idx % 13])
-        dealer_total, _ = get_hand_total(dealer_hand)
-
-        if player_total == 21:
-            results[i, 0] = 1.5 if dealer_total != 21 else 0.0
-            continue
-        if dealer_total == 21:
-            results[i, 0] = -1.0
-            continue
-        
-        # --- Splitting Logic ---
-        is_pair = p_ranks[0] == p_ranks[1]
-        pair_rank = p_ranks[0]
-        should_split = False
-        if is_pair:
-            dealer_up_val = get_hand_total(np.array([d_rank]))[0]
-            if pair_rank in (0, 7): should_split = True # Aces and 8s
-            if pair_rank == 8 and dealer_up_val not in (7, 10, 11): should_split = True # 9s
-            # Simplified split logic for simulation speed
-            if pair_rank in (1, 2, 6) and dealer_up_val <= 7: should_split = True # 2s, 3s, 7s
-            if pair_rank == 5 and dealer_up_val <= 6: should_split = True # 6s
-
-        if should_split:
-            # Play two separate hands
-            hand1_card2_idx = draw_card(temp_shoe)
-            hand2_card2_idx = draw_card(temp_shoe)
-            if -1 in (hand1_card2_idx, hand2_card2_idx): continue
-
-            hand1 = np.array([pair_rank, hand1_card2_idx % 13])
-            hand2 = np.array([pair_rank, hand2_card2_idx % 13])
-            
-            p1_final, mult1 = _play_single_hand(hand1, temp_shoe, d_rank)
-            p2_final, mult2 = _play_single_hand(hand2, temp_shoe, d_rank)
-            
-            # Dealer plays out their hand once
-            while get_hand_total(dealer_hand)[0] < 17:
-                card_idx = draw_card(temp_shoe)
-                if card_idx == -1: break
-                dealer_hand = np.append(dealer_hand, card_idx % 13)
-            dealer_final_val = get_hand_total(dealer_hand)[0]
-
-            outcome1 = _resolve_outcome(p1_final, dealer_final_val, mult1)
-            outcome2 = _resolve_outcome(p2_final, dealer_final_val, mult2)
-            results[i, 0] = outcome1 + outcome2
-        else:
-            # --- Standard Hand Logic ---
-            player_final_total, bet_multiplier = _play_single_hand(p_ranks, temp_shoe, d_rank)
-            while get_hand_total(dealer_hand)[0] < 17:
-                card_idx = draw_card(temp_shoe)
-                if card_idx == -1: break
-                dealer_hand = np.append(dealer_hand, card_idx % 13)
-            dealer_final_val = get_hand_total(dealer_hand)[0]
-            results[i, 0] = _resolve_outcome(player_final_total, dealer_final_val, bet_multiplier)
-
-        if get_hand_total(dealer_hand)[0] > 21:
-            # Bust bet logic remains the same
-            num_cards = len(dealer_hand)
-            if num_cards == 3: results[i, 1] = 1.0
-            elif num_cards == 4: results[i, 1] = 2.0
-            elif num_cards >= 5: results[i, 1] = 15.0 # Simplified payout for >5 cards
-            else: results[i, 1] = -1.0
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1:
+            _diag_add(diag, DIAG_EMPTY_DRAWS)
+            return player_total, 1.0
+        _diag_add(diag, DIAG_PLAYER_HITS)
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+
+@njit(cache=True)
+def _play_dealer_hand(
+    hard_total: int, aces: int, n_cards: int, temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, diag
+) -> tuple[int, int]:
+    """
+    Draws to the dealer's hand until it reaches 17 (stands on all 17s).
+    Returns the final total and number of cards.
+    """
+    while hand_state_total(hard_total, aces)[0] < 17:
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1:
+            _diag_add(diag, DIAG_EMPTY_DRAWS)
+            break
+        _diag_add(diag, DIAG_DEALER_DRAWS)
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+        n_cards += 1
+    return hand_state_total(hard_total, aces)[0], n_cards
+
+@njit(cache=True)
+def _should_split(pair_rank: int, dealer_up_rank: int) -> bool:
+    """Simplified pair-splitting strategy used by the simulator."""
+    dealer_up_val = get_card_value_numba(dealer_up_rank)
+    if pair_rank in (0, 7): return True # Aces and 8s
+    if pair_rank == 8 and dealer_up_val not in (7, 10, 11): return True # 9s
+    # Simplified split logic for simulation speed
+    if pair_rank in (1, 2, 6) and dealer_up_val <= 7: return True # 2s, 3s, 7s
+    if pair_rank == 5 and dealer_up_val <= 6: return True # 6s
+    return False
+
+@njit(cache=True)
+def _should_surrender(p1_rank: int, p2_rank: int, dealer_up_rank: int, early: bool) -> bool:
+    """
+    Surrender strategy for a hard two-card hand. Late: 16 (not 8-8) against
+    9, ten or Ace, and 15 against a ten. Early adds hard 5-7 and 12-17
+    against an Ace and hard 14-16 against a ten, pairs included.
+    """
+    hard_total, aces = add_card_to_hand(0, 0, p1_rank)
+    hard_total, aces = add_card_to_hand(hard_total, aces, p2_rank)
+    if aces > 0: return False
+    ace_up, ten_up = dealer_up_rank == 0, dealer_up_rank >= 9
+    if early and ace_up: return 5 <= hard_total <= 7 or 12 <= hard_total <= 17
+    if early and ten_up: return 14 <= hard_total <= 16
+    if p1_rank == 7 and p2_rank == 7: return False
+    if hard_total == 16: return ace_up or ten_up or dealer_up_rank == 8
+    return hard_total == 15 and ten_up
+
+@njit(cache=True)
+def _play_spot(
+    p1_rank: int, p2_rank: int, dealer_up_rank: int, temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, diag
+) -> tuple[int, float, int, float]:
+    """
+    Plays one spot's starting hand, splitting it once if the strategy says so.
+    Returns (total, multiplier) for the first hand and for the split hand; the
+    split hand's multiplier is 0.0 when there was no split, and both are 0.0
+    if the shoe ran dry while dealing the split.
+    """
+    if p1_rank == p2_rank and _should_split(p1_rank, dealer_up_rank):
+        # Play two separate hands
+        _diag_add(diag, DIAG_SPLITS)
+        hand1_card2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        hand2_card2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if -1 in (hand1_card2_idx, hand2_card2_idx):
+            _diag_add(diag, DIAG_EMPTY_DRAWS)
+            return 0, 0.0, 0, 0.0
+
+        h1_hard, h1_aces = add_card_to_hand(0, 0, p1_rank)
+        h1_hard, h1_aces = add_card_to_hand(h1_hard, h1_aces, hand1_card2_idx % 13)
+        h2_hard, h2_aces = add_card_to_hand(0, 0, p1_rank)
+        h2_hard, h2_aces = add_card_to_hand(h2_hard, h2_aces, hand2_card2_idx % 13)
+
+        p1_final, mult1 = _play_single_hand(h1_hard, h1_aces, 2, temp_shoe, undo_log, dealer_up_rank, rng, diag)
+        p2_final, mult2 = _play_single_hand(h2_hard, h2_aces, 2, temp_shoe, undo_log, dealer_up_rank, rng, diag)
+        if p1_final > 21: _diag_add(diag, DIAG_PLAYER_BUSTS)
+        if p2_final > 21: _diag_add(diag, DIAG_PLAYER_BUSTS)
+        return p1_final, mult1, p2_final, mult2
+
+    # --- Standard Hand Logic ---
+    hard_total, aces = add_card_to_hand(0, 0, p1_rank)
+    hard_total, aces = add_card_to_hand(hard_total, aces, p2_rank)
+    player_final_total, bet_multiplier = _play_single_hand(hard_total, aces, 2, temp_shoe, undo_log, dealer_up_rank, rng, diag)
+    if player_final_total > 21: _diag_add(diag, DIAG_PLAYER_BUSTS)
+    return player_final_total, bet_multiplier, 0, 0.0
+
+@njit(cache=True)
+def _play_seat(
+    strategy: int, hard_total: int, aces: int, temp_shoe: np.ndarray, undo_log: np.ndarray,
+    dealer_up_rank: int, rng: np.ndarray
+) -> None:
+    """
+    Plays another player's two-card hand to completion, drawing from the shoe.
+    basic: the simulator's strategy, without splits. never_bust: hits hard 11
+    or less and soft 17 or less. mimic_dealer: hits below 17 like the dealer.
+    """
+    if strategy == SEAT_BASIC:
+        _play_single_hand(hard_total, aces, 2, temp_shoe, undo_log, dealer_up_rank, rng, None)
+        return
+    while True:
+        total, _ = hand_state_total(hard_total, aces)
+        if strategy == SEAT_NEVER_BUST:
+            # Only a hand still counting an Ace as 11 is safe to hit above hard 11.
+            counts_ace_high = aces > 0 and hard_total + 10 <= 21
+            if total > (17 if counts_ace_high else 11): return
+        elif total >= 17: return
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1: return
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+
+@njit(cache=True)
+def _seat_count(seats) -> int:
+    if seats is None: return 0
+    return len(seats)
+
+@njit(cache=True)
+def _play_other_seats(
+    seats, temp_shoe: np.ndarray, undo_log: np.ndarray, dealer_up_rank: int, dealer_blackjack: bool, rng: np.ndarray
+) -> None:
+    """
+    Deals and plays the hands of other players at the table, who only consume
+    cards. seats is None or an array of SEAT_* strategy codes. Each seat is
+    dealt two cards and, unless the dealer has blackjack, plays its strategy.
+    """
+    if seats is None: return
+    for k in range(len(seats)):
+        c1 = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        c2 = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if c1 == -1 or c2 == -1: return
+        if dealer_blackjack: continue
+        hard_total, aces = add_card_to_hand(0, 0, c1 % 13)
+        hard_total, aces = add_card_to_hand(hard_total, aces, c2 % 13)
+        _play_seat(seats[k], hard_total, aces, temp_shoe, undo_log, dealer_up_rank, rng)
+
+@njit(cache=True)
+def _simulate_round(
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, results: np.ndarray, diag,
+    seats_before=None, seats_after=None, surrender: int = SURRENDER_NONE, insurance_tc: float = np.inf
+) -> None:
+    """
+    Plays one round from the scratch shoe temp_shoe, with logic to handle one
+    split, and writes each bet's outcome into the results row (left at 0.0 if
+    the shoe runs dry). Every card drawn is recorded in undo_log.
+
+    surrender is a SURRENDER_* rule. A surrendered hand is still played out on
+    the round's stream so surrender_gain_ev can compare the two, which is only
+    meaningful where the round's cards are put back afterwards. Insurance (even
+    money with a blackjack) is taken for half the bet against an Ace when the
+    Hi-Lo true count of the cards seen (player cards and upcard) is at least
+    insurance_tc; the default never takes it.
+
+    seats_before / seats_after are None or arrays of SEAT_* strategy codes for
+    other players acting before / after the player, who only consume cards;
+    without them the round is the classic heads-up round.
+    When other seats are present the dealer still plays out after a player
+    blackjack, as it would for them.
+    """
+    p1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    p2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if -1 in (p1_idx, p2_idx, d1_idx):
+        _diag_add(diag, DIAG_EMPTY_DRAWS)
+        return
+
+    p1_rank, p2_rank = p1_idx % 13, p2_idx % 13
+    d_rank, d_suit = d1_idx % 13, d1_idx // 13
+
+    results[2] = evaluate_21plus3_cards(p1_rank, p2_rank, d_rank, p1_idx // 13, p2_idx // 13, d_suit)
+    results[3] = evaluate_perfect_pairs_cards(p1_rank, p2_rank, p1_idx // 13, p2_idx // 13)
+    results[4] = evaluate_hot3_cards(p1_rank, p2_rank, d_rank)
+
+    p_hard, p_aces = add_card_to_hand(0, 0, p1_rank)
+    p_hard, p_aces = add_card_to_hand(p_hard, p_aces, p2_rank)
+    player_total, _ = hand_state_total(p_hard, p_aces)
+    # Decided before the hole card is drawn, so the count covers only the cards the player has seen.
+    insure = insurance_tc < np.inf and d_rank == 0 and hilo_true_count(temp_shoe) >= insurance_tc
+    surrendered = surrender != SURRENDER_NONE and _should_surrender(p1_rank, p2_rank, d_rank, surrender == SURRENDER_EARLY)
+    d_hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if d_hole_idx == -1:
+        _diag_add(diag, DIAG_EMPTY_DRAWS)
+        return
+    
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    dealer_total, _ = hand_state_total(d_hard, d_aces)
+    if insure:
+        _diag_add(diag, DIAG_INSURANCES)
+        results[BET_EVEN_MONEY if player_total == 21 else BET_INSURANCE] = 1.0 if dealer_total == 21 else -0.5
+    _play_other_seats(seats_before, temp_shoe, undo_log, d_rank, dealer_total == 21, rng)
+
+    if player_total == 21:
+        _diag_add(diag, DIAG_BLACKJACKS)
+        if dealer_total == 21: _diag_add(diag, DIAG_DEALER_BLACKJACKS)
+        results[0] = 1.5 if dealer_total != 21 else 0.0
+        _play_other_seats(seats_after, temp_shoe, undo_log, d_rank, dealer_total == 21, rng)
+        if _seat_count(seats_before) + _seat_count(seats_after) > 0 and dealer_total != 21:
+            _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+        return
+    if dealer_total == 21:
+        _diag_add(diag, DIAG_DEALER_BLACKJACKS)
+        results[0] = -1.0
+        if surrendered and surrender == SURRENDER_EARLY:
+            _diag_add(diag, DIAG_SURRENDERS)
+            results[0], results[BET_SURRENDER_GAIN] = -0.5, 0.5
+        _play_other_seats(seats_after, temp_shoe, undo_log, d_rank, True, rng)
+        return
+    
+    if surrendered: _diag_add(diag, DIAG_SURRENDERS)
+    t1, m1, t2, m2 = _play_spot(p1_rank, p2_rank, d_rank, temp_shoe, undo_log, rng, diag)
+    if m1 == 0.0: return  # the shoe ran dry dealing a split
+    _play_other_seats(seats_after, temp_shoe, undo_log, d_rank, False, rng)
+
+    # Dealer plays out their hand once
+    dealer_final_val, dealer_cards = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, diag)
+    results[0] = _resolve_outcome(t1, dealer_final_val, m1)
+    if m2 > 0.0: results[0] += _resolve_outcome(t2, dealer_final_val, m2)
+    if surrendered: results[0], results[BET_SURRENDER_GAIN] = -0.5, -0.5 - results[0]
+
+    if dealer_final_val > 21:
+        _diag_add(diag, DIAG_DEALER_BUSTS)
+        # Bust bet logic remains the same
+        if dealer_cards == 3: results[1] = 1.0
+        elif dealer_cards == 4: results[1] = 2.0
+        elif dealer_cards >= 5: results[1] = 15.0 # Simplified payout for >5 cards
+        else: results[1] = -1.0
+    else:
+        results[1] = -1.0
+
+@njit(cache=True)
+def _accumulate_rounds(
+    shoe_counts: np.ndarray, seed: int, lo: int, hi: int, out: np.ndarray, diag,
+    surrender: int = SURRENDER_NONE, insurance_tc: float = np.inf
+) -> None:
+    """
+    Plays rounds [lo, hi) from shoe_counts, adding outcome sums and squares into
+    out. One scratch shoe is reused for every round and restored from the undo
+    log afterwards, so the loop allocates nothing per round.
+    """
+    rng = np.zeros(1, dtype=np.uint64)
+    row = np.zeros(NUM_BETS, dtype=np.float64)
+    temp_shoe = make_scratch_shoe(shoe_counts)
+    undo_log = make_undo_log()
+    empty_before = 0
+    for i in range(lo, hi):
+        rng[0] = rng_stream_state(seed, i)
+        row[:] = 0.0
+        if diag is not None: empty_before = diag[DIAG_EMPTY_DRAWS]
+        _simulate_round(temp_shoe, undo_log, rng, row, diag, None, None, surrender, insurance_tc)
+        if diag is not None:
+            diag[DIAG_ROUNDS] += 1
+            diag[DIAG_CARDS] += undo_log[0]
+            if diag[DIAG_EMPTY_DRAWS] > empty_before: diag[DIAG_TRUNCATED] += 1
+        restore_scratch_shoe(temp_shoe, undo_log)
+        for k in range(NUM_BETS):
+            out[0, k] += row[k]
+            out[1, k] += row[k] * row[k]
+
+@njit(parallel=True)
+def simulate_chunk(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int, block_rounds: int = BLOCK_ROUNDS,
+    surrender: int = SURRENDER_NONE, insurance_tc: float = np.inf
+) -> np.ndarray:
+    """
+    Simulates rounds [start_round, start_round + rounds) of the stream keyed by
+    seed and returns a (2, NUM_BETS) array of per-bet outcome sums and sums of
+    squares. Round i always uses random stream i, so any partition of a run into
+    chunks yields the same totals. surrender and insurance_tc are as in
+    _simulate_round.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial = np.zeros((max(n_blocks, 1), 2, NUM_BETS), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            lo = start_round + (rounds * b) // n_blocks
+            hi = start_round + (rounds * (b + 1)) // n_blocks
+            _accumulate_rounds(shoe_counts, seed, lo, hi, partial[b], None, surrender, insurance_tc)
+    return reduce_blocks(partial)
+
+@njit(parallel=True)
+def simulate_chunk_diagnostics(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int, block_rounds: int = BLOCK_ROUNDS,
+    surrender: int = SURRENDER_NONE, insurance_tc: float = np.inf
+) -> tuple[np.ndarray, np.ndarray]:
+    """
+    simulate_chunk with the diagnostic counters compiled in. Returns the
+    (2, NUM_BETS) totals and a (threads, NUM_DIAG) array of per-thread counters,
+    indexed by Numba thread id. Outcomes are identical to simulate_chunk for
+    the same seed and rounds.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial = np.zeros((max(n_blocks, 1), 2, NUM_BETS), dtype=np.float64)
+    diag = np.zeros((_MAX_THREADS, NUM_DIAG), dtype=np.int64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            lo = start_round + (rounds * b) // n_blocks
+            hi = start_round + (rounds * (b + 1)) // n_blocks
+            # A block runs start to finish on one thread, so its row is never shared concurrently.
+            _accumulate_rounds(shoe_counts, seed, lo, hi, partial[b], diag[get_thread_id()], surrender, insurance_tc)
+    return reduce_blocks(partial), diag
+
+@njit(parallel=True)
+def simulate_batch(
+    shoe_matrix: np.ndarray, rounds: int, seed: int, start_round: int, block_rounds: int = BLOCK_ROUNDS
+) -> np.ndarray:
+    """
+    Simulates the same round range for every shoe (row) of shoe_matrix in one
+    parallel launch and returns a (tables, 2, NUM_BETS) array of sums and sums
+    of squares. All tables share the seed's streams (common random numbers).
+    Plays with no surrender and no insurance, so those columns stay 0.0.
+    """
+    n_tables = shoe_matrix.shape[0]
+    blocks_per_table = max(1, min(rounds, get_num_threads() // max(n_tables, 1)))
+    if block_rounds > 0: blocks_per_table = max(blocks_per_table, min(rounds, (rounds + block_rounds - 1) // block_rounds))
+    n_tasks = n_tables * blocks_per_table
+    partial = np.zeros((max(n_tasks, 1), 2, NUM_BETS), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for task in prange(n_tasks):
+            t = task // blocks_per_table
+            b = task % blocks_per_table
+            lo = start_round + (rounds * b) // blocks_per_table
+            hi = start_round + (rounds * (b + 1)) // blocks_per_table
+            _accumulate_rounds(shoe_matrix[t], seed, lo, hi, partial[task], None)
+
+    totals = np.zeros((n_tables, 2, NUM_BETS), dtype=np.float64)
+    for task in range(n_tasks):
+        t = task // blocks_per_table
+        for k in range(NUM_BETS):
+            totals[t, 0, k] += partial[task, 0, k]
+            totals[t, 1, k] += partial[task, 1, k]
+    return totals
+
+# --- Multi-spot play ---
+MAX_SPOTS = 7
+
+@njit(cache=True)
+def _simulate_spots_round(
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, n_spots: int,
+    first_cards: np.ndarray, hands: np.ndarray, outcomes: np.ndarray,
+    seats_before=None, seats_after=None
+) -> bool:
+    """
+    Plays one round with n_spots player spots against a single dealer hand and
+    writes each spot's main-bet outcome into outcomes[:n_spots]. first_cards
+    (MAX_SPOTS, 2) and hands (MAX_SPOTS, 4) are per-thread scratch buffers; a
+    spot's hands are held as (total, multiplier, split total, split multiplier)
+    until the dealer has played. The first spot's cards are drawn before the
+    dealer's, so a single spot draws exactly like _simulate_round. Returns
+    False (outcomes all 0.0) if the initial deal ran the shoe dry.
+    seats_before / seats_after are other players as in _simulate_round.
+    """
+    outcomes[:n_spots] = 0.0
+    first_cards[0, 0] = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    first_cards[0, 1] = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d_hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if -1 in (first_cards[0, 0], first_cards[0, 1], d1_idx, d_hole_idx): return False
+    for spot in range(1, n_spots):
+        first_cards[spot, 0] = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        first_cards[spot, 1] = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if first_cards[spot, 0] == -1 or first_cards[spot, 1] == -1: return False
+
+    d_rank = d1_idx % 13
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    dealer_blackjack = hand_state_total(d_hard, d_aces)[0] == 21
+    _play_other_seats(seats_before, temp_shoe, undo_log, d_rank, dealer_blackjack, rng)
+
+    any_live = _seat_count(seats_before) + _seat_count(seats_after) > 0 and not dealer_blackjack
+    for spot in range(n_spots):
+        hands[spot, :] = 0.0
+        r1, r2 = first_cards[spot, 0] % 13, first_cards[spot, 1] % 13
+        hard_total, aces = add_card_to_hand(0, 0, r1)
+        hard_total, aces = add_card_to_hand(hard_total, aces, r2)
+        if hand_state_total(hard_total, aces)[0] == 21:
+            outcomes[spot] = 0.0 if dealer_blackjack else 1.5
+        elif dealer_blackjack:
+            outcomes[spot] = -1.0
         else:
-            results[i, 1] = -1.0
+            t1, m1, t2, m2 = _play_spot(r1, r2, d_rank, temp_shoe, undo_log, rng, None)
+            hands[spot, 0], hands[spot, 1], hands[spot, 2], hands[spot, 3] = t1, m1, t2, m2
+            if m1 > 0.0: any_live = True
+    _play_other_seats(seats_after, temp_shoe, undo_log, d_rank, dealer_blackjack, rng)
+
+    if not any_live: return True
+    dealer_final_val, _ = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+    for spot in range(n_spots):
+        if hands[spot, 1] == 0.0: continue
+        outcomes[spot] = _resolve_outcome(int(hands[spot, 0]), dealer_final_val, hands[spot, 1])
+        if hands[spot, 3] > 0.0: outcomes[spot] += _resolve_outcome(int(hands[spot, 2]), dealer_final_val, hands[spot, 3])
+    return True
+
+@njit(parallel=True)
+def simulate_spots_chunk(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int, n_spots: int,
+    block_rounds: int = BLOCK_ROUNDS
+) -> tuple[np.ndarray, np.ndarray]:
+    """
+    Simulates rounds with n_spots (1..MAX_SPOTS) spots sharing one dealer hand.
+    Returns the per-spot main-bet outcome sums (n_spots,) and the sums of
+    outcome products between spots (n_spots, n_spots), from which per-spot EV
+    and the covariance matrix follow.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial_sums = np.zeros((max(n_blocks, 1), n_spots), dtype=np.float64)
+    partial_products = np.zeros((max(n_blocks, 1), n_spots, n_spots), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            rng = np.zeros(1, dtype=np.uint64)
+            temp_shoe = make_scratch_shoe(shoe_counts)
+            undo_log = make_undo_log(UNDO_CAPACITY * MAX_SPOTS)
+            first_cards = np.zeros((MAX_SPOTS, 2), dtype=np.int64)
+            hands = np.zeros((MAX_SPOTS, 4), dtype=np.float64)
+            outcomes = np.zeros(MAX_SPOTS, dtype=np.float64)
+            for i in range(start_round + (rounds * b) // n_blocks, start_round + (rounds * (b + 1)) // n_blocks):
+                rng[0] = rng_stream_state(seed, i)
+                _simulate_spots_round(temp_shoe, undo_log, rng, n_spots, first_cards, hands, outcomes)
+                restore_scratch_shoe(temp_shoe, undo_log)
+                for x in range(n_spots):
+                    partial_sums[b, x] += outcomes[x]
+                    for y in range(n_spots):
+                        partial_products[b, x, y] += outcomes[x] * outcomes[y]
+
+    sums = np.zeros(n_spots, dtype=np.float64)
+    products = np.zeros((n_spots, n_spots), dtype=np.float64)
+    for b in range(partial_sums.shape[0]):
+        sums += partial_sums[b]
+        products += partial_products[b]
+    return sums, products
+
+class SimAccumulator:
+    """
+    Streaming per-bet sums for a simulation run. Accumulators from different
+    threads, processes or hosts merge by plain addition, and every outcome is a
+    multiple of 0.5, so merged totals are exact regardless of merge order.
+    """
+    def __init__(self, rounds: int = 0, sums: np.ndarray | None = None, sums_sq: np.ndarray | None = None):
+        self.rounds = rounds
+        self.sums = np.zeros(NUM_BETS) if sums is None else np.asarray(sums, dtype=np.float64)
+        self.sums_sq = np.zeros(NUM_BETS) if sums_sq is None else np.asarray(sums_sq, dtype=np.float64)
+
+    def __repr__(self) -> str:
+        return f"<SimAccumulator(rounds={self.rounds}, main_ev={self.mean().get('main_ev', 0.0):+.5f})>"
+
+    def add_chunk(self, totals: np.ndarray, rounds: int) -> None:
+        """Folds in the (2, NUM_BETS) output of simulate_chunk."""
+        self.rounds += rounds
+        self.sums += totals[0]
+        self.sums_sq += totals[1]
+
+    def merge(self, other: 'SimAccumulator') -> None:
+        """Adds another accumulator's rounds and sums into this one."""
+        self.rounds += other.rounds
+        self.sums += other.sums
+        self.sums_sq += other.sums_sq
+
+    def mean(self) -> dict[str, float]:
+        """Returns the mean EV for each bet type."""
+        if self.rounds == 0: return {}
+        return {key: float(self.sums[k] / self.rounds) for k, key in enumerate(BET_KEYS)}
+
+    def std_dev(self) -> dict[str, float]:
+        """Returns the per-round standard deviation of each bet's outcome."""
+        if self.rounds < 2: return {}
+        means = self.sums / self.rounds
+        variances = np.maximum(self.sums_sq / self.rounds - means * means, 0.0) * self.rounds / (self.rounds - 1)
+        return {key: float(np.sqrt(variances[k])) for k, key in enumerate(BET_KEYS)}
 
-    return results
+    def std_error(self) -> dict[str, float]:
+        """Returns the standard error of each bet's mean EV."""
+        return {key: float(sd / np.sqrt(self.rounds)) for key, sd in self.std_dev().items()}
+
+    def to_dict(self) -> dict:
+        """Serializes the accumulator to plain JSON-compatible types."""
+        return {"rounds": self.rounds, "sums": self.sums.tolist(), "sums_sq": self.sums_sq.tolist()}
+
+    @classmethod
+    def from_dict(cls, data: dict) -> 'SimAccumulator':
+        """Inverse of to_dict."""
+        return cls(int(data["rounds"]), data["sums"], data["sums_sq"])
+
+class SimulationCheckpoint:
+    """
+    Everything needed to resume a run exactly: the shoe, the rules (surrender
+    rule name and insurance true count, None for never), the seed, the target
+    round count, the next round to simulate (which fully determines the RNG
+    stream position) and the accumulator so far. Because accumulated outcomes
+    are exact sums, a resumed run's totals are bit-identical to an
+    uninterrupted one.
+    """
+    def __init__(self, shoe_counts: np.ndarray, seed: int, total_rounds: int,
+                 next_round: int = 0, accumulator: SimAccumulator | None = None,
+                 surrender: str = "none", insurance_tc: float | None = None):
+        self.shoe_counts = np.asarray(shoe_counts, dtype=np.int32)
+        self.seed = seed
+        self.total_rounds = total_rounds
+        self.next_round = next_round
+        self.accumulator = accumulator or SimAccumulator()
+        self.surrender = surrender
+        self.insurance_tc = insurance_tc
+
+    def __repr__(self) -> str:
+        return f"<SimulationCheckpoint(seed={self.seed}, rounds={self.next_round}/{self.total_rounds})>"
+
+    @property
+    def rules(self) -> tuple[str, float | None]:
+        return self.surrender, self.insurance_tc
+
+    @property
+    def is_complete(self) -> bool:
+        return self.next_round >= self.total_rounds
+
+    def to_dict(self) -> dict:
+        return {
+            "shoe_counts": self.shoe_counts.tolist(), "seed": self.seed,
+            "total_rounds": self.total_rounds, "next_round": self.next_round,
+            "accumulator": self.accumulator.to_dict(),
+            "surrender": self.surrender, "insurance_tc": self.insurance_tc,
+        }
+
+    @classmethod
+    def from_dict(cls, data: dict) -> 'SimulationCheckpoint':
+        """Inverse of to_dict; checkpoints from before the rule fields were stored played neither rule."""
+        insurance_tc = data.get("insurance_tc")
+        return cls(data["shoe_counts"], int(data["seed"]), int(data["total_rounds"]),
+                   int(data["next_round"]), SimAccumulator.from_dict(data["accumulator"]),
+                   data.get("surrender", "none"), None if insurance_tc is None else float(insurance_tc))
+
+    def save(self, path: str) -> None:
+        """Writes the checkpoint atomically, so an interruption never leaves a torn file."""
+        tmp_path = f"{path}.tmp"
+        with open(tmp_path, "w") as f:
+            json.dump(self.to_dict(), f)
+        os.replace(tmp_path, path)
+
+    @classmethod
+    def load(cls, path: str) -> 'SimulationCheckpoint':
+        with open(path) as f:
+            return cls.from_dict(json.load(f))
+
+# Held around parallel kernel launches made from more than one Python thread
+# (the service's batchers, the distributed worker's connections, the GUI's
+# simulation and advisory threads): Numba's workqueue threading layer, the
+# fallback when neither TBB nor OpenMP is installed, aborts when two parallel
+# kernels are launched at once.
+KERNEL_LAUNCH_LOCK = threading.Lock()
+
+@contextmanager
+def numba_threads(num_threads: int):
+    """Runs the enclosed kernel calls on up to num_threads Numba threads, then restores the previous count."""
+    previous_threads = numba.get_num_threads()
+    numba.set_num_threads(max(1, min(num_threads, numba.config.NUMBA_NUM_THREADS)))
+    try:
+        yield
+    finally:
+        numba.set_num_threads(previous_threads)
+
+def run_engine(kernel, args: tuple, rounds: int, keys: tuple[str, ...], num_threads: int = 4) -> dict:
+    """
+    Calls a game engine's chunk kernel, which returns the (2, len(keys)) outcome
+    sums and sums of squares of `rounds` rounds, on up to num_threads threads.
+    Returns the mean ("ev") and standard error ("std_error") of every column.
+    """
+    with numba_threads(num_threads):
+        totals = kernel(*args)
+    means = totals[0] / rounds
+    variances = np.maximum(totals[1] / rounds - means * means, 0.0)
+    return {
+        "ev": {key: float(means[k]) for k, key in enumerate(keys)},
+        "std_error": {key: float(np.sqrt(variances[k] / rounds)) for k, key in enumerate(keys)},
+    }
 
 class FastSimulator:
-    def __init__(self, shoe_dict: dict[str, int]):
+    def __init__(self, shoe_dict: dict[str, int], surrender: str = "none", insurance_tc: float | None = None):
+        """
+        surrender is one of SURRENDER_RULES. insurance_tc is the Hi-Lo true
+        count at which insurance and even money are taken (the advisor uses
+        STRATEGY_CONFIG["insurance_threshold"]); None never takes them. Both
+        apply to the single-spot runs and checkpoints record them; run_spots
+        and simulate_batch play without them.
+
+        Raises:
+            ValueError: If surrender is not a known rule.
+        """
+        if surrender not in SURRENDER_RULES:
+            raise ValueError(f"Unknown surrender rule {surrender!r}; expected one of {SURRENDER_RULES}.")
         self.shoe_counts = self._encode_shoe(shoe_dict)
+        self.surrender = SURRENDER_RULES.index(surrender)
+        self.insurance_tc = np.inf if insurance_tc is None else float(insurance_tc)
+        self.last_seed: int | None = None
 
     def _encode_shoe(self, shoe_dict: dict[str, int]) -> np.ndarray:
         """Encodes the shoe dictionary into a 52-element numpy array for Numba."""
@@ -173,23 +762,172 @@ class FastSimulator:
             shoe_counts[idx] = count
         return shoe_counts
 
-    def run(self, total_rounds: int = 500_000, num_threads: int = 4) -> dict[str, float]:
+    @property
+    def rules(self) -> tuple[str, float | None]:
+        """The surrender rule name and insurance true count (None for never), as given to __init__."""
+        return SURRENDER_RULES[self.surrender], None if np.isinf(self.insurance_tc) else self.insurance_tc
+
+    def run(self, total_rounds: int = 500_000, num_threads: int = 4, seed: int | None = None) -> dict[str, float]:
         """Runs the simulation in parallel and returns the mean EV for each bet type."""
-        if total_rounds < num_threads: num_threads = total_rounds
-        if total_rounds == 0: return {}
-
-        rounds_per_thread = total_rounds // num_threads
-
-        with ThreadPoolExecutor(max_workers=num_threads) as executor:
-            futures = [executor.submit(simulate_chunk, self.shoe_counts.copy(), rounds_per_thread) for _ in range(num_threads)]
-            batch_results = [f.result() for f in futures]
-
-        all_results = np.vstack(batch_results)
-        evs = {
-            "main_ev": np.mean(all_results[:, 0]), 
-            "bust_ev": np.mean(all_results[:, 1]),
-            "21+3_ev": np.mean(all_results[:, 2]), 
-            "perfect_pairs_ev": np.mean(all_results[:, 3]),
-            "hot3_ev": np.mean(all_results[:, 4]),
+        return self.run_accumulated(total_rounds, num_threads, seed).mean()
+
+    def run_accumulated(
+        self,
+        total_rounds: int,
+        num_threads: int = 4,
+        seed: int | None = None,
+        start_round: int = 0
+    ) -> SimAccumulator:
+        """
+        Simulates rounds [start_round, start_round + total_rounds) of the given
+        seed's stream on up to num_threads Numba threads and returns the raw
+        accumulator. A random seed is chosen (and kept in self.last_seed) when
+        none is given. The range goes to the kernel in a single launch; its
+        block scheduler does the load balancing.
+        """
+        self.last_seed = random.getrandbits(63) if seed is None else seed
+        accumulator = SimAccumulator()
+        if total_rounds <= 0: return accumulator
+
+        with numba_threads(num_threads):
+            accumulator.add_chunk(simulate_chunk(
+                self.shoe_counts, total_rounds, self.last_seed, start_round, BLOCK_ROUNDS,
+                self.surrender, self.insurance_tc), total_rounds)
+        return accumulator
+
+    def run_progressive(
+        self,
+        total_rounds: int,
+        num_threads: int = 4,
+        seed: int | None = None,
+        first_chunk: int = 5_000,
+        max_chunk: int = 50_000,
+        on_progress=None,
+        should_stop=None,
+        launch_lock=None
+    ) -> SimAccumulator:
+        """
+        Runs the simulation in growing chunks (first_chunk, doubling up to
+        max_chunk) and passes the running accumulator to on_progress after each
+        one, so callers can show an estimate within milliseconds and refine it.
+        should_stop is checked before every chunk; when it returns True the
+        partial accumulator is returned. Because each round has its own random
+        stream, a run that completes gives the same totals as run_accumulated.
+        launch_lock (e.g. KERNEL_LAUNCH_LOCK), if given, is held around each
+        chunk and released between them, so other threads' kernels can run.
+        """
+        self.last_seed = random.getrandbits(63) if seed is None else seed
+        accumulator = SimAccumulator()
+        chunk = max(1, first_chunk)
+        while accumulator.rounds < total_rounds:
+            if should_stop and should_stop(): break
+            rounds = min(chunk, total_rounds - accumulator.rounds)
+            with launch_lock or nullcontext():
+                accumulator.merge(self.run_accumulated(rounds, num_threads, self.last_seed, accumulator.rounds))
+            if on_progress: on_progress(accumulator)
+            chunk = min(chunk * 2, max(max_chunk, first_chunk))
+        return accumulator
+
+    def run_spots(
+        self,
+        total_rounds: int,
+        n_spots: int = 2,
+        our_spots: tuple[int, ...] = (0, 1),
+        num_threads: int = 4,
+        seed: int | None = None
+    ) -> dict:
+        """
+        Simulates n_spots spots sharing the dealer hand; spots are numbered in
+        playing order and our_spots marks the ones we play. Returns the EV and
+        standard deviation of every spot, the covariance matrix between spots,
+        and for our spots combined the total EV and variance per round. Plays
+        with no surrender and no insurance, whatever the simulator's rules.
+        """
+        if not 1 <= n_spots <= MAX_SPOTS:
+            raise ValueError(f"Number of spots must be between 1 and {MAX_SPOTS}.")
+        if not our_spots or any(not 0 <= spot < n_spots for spot in our_spots):
+            raise ValueError("our_spots must name at least one spot in range.")
+        self.last_seed = random.getrandbits(63) if seed is None else seed
+
+        with numba_threads(num_threads):
+            sums, products = simulate_spots_chunk(self.shoe_counts, total_rounds, self.last_seed, 0, n_spots)
+
+        means = sums / total_rounds
+        covariance = (products / total_rounds - np.outer(means, means)) * total_rounds / max(total_rounds - 1, 1)
+        ours = list(our_spots)
+        return {
+            "rounds": total_rounds,
+            "ev_per_spot": means.tolist(),
+            "std_dev_per_spot": np.sqrt(np.maximum(np.diag(covariance), 0.0)).tolist(),
+            "covariance": covariance.tolist(),
+            "our_spots": ours,
+            "our_ev": float(means[ours].sum()),
+            "our_variance": float(covariance[np.ix_(ours, ours)].sum()),
+        }
+
+    def run_with_diagnostics(
+        self, total_rounds: int, num_threads: int = 4, seed: int | None = None
+    ) -> tuple[SimAccumulator, dict]:
+        """
+        Runs the diagnostics build of the kernel on up to num_threads threads.
+        Returns the accumulator and a dict with the summed counters ("totals")
+        and each thread's counters ("per_thread", threads that ran at least one
+        round), keyed by DIAG_KEYS.
+        """
+        self.last_seed = random.getrandbits(63) if seed is None else seed
+        accumulator = SimAccumulator()
+        if total_rounds <= 0: return accumulator, {"totals": {key: 0 for key in DIAG_KEYS}, "per_thread": []}
+        with numba_threads(num_threads):
+            totals, per_thread = simulate_chunk_diagnostics(
+                self.shoe_counts, total_rounds, self.last_seed, 0, BLOCK_ROUNDS, self.surrender, self.insurance_tc)
+        accumulator.add_chunk(totals, total_rounds)
+        summed = per_thread.sum(axis=0)
+        return accumulator, {
+            "totals": {key: int(summed[k]) for k, key in enumerate(DIAG_KEYS)},
+            "per_thread": [{key: int(row[k]) for k, key in enumerate(DIAG_KEYS)} for row in per_thread if row[DIAG_ROUNDS] > 0],
         }
-        return evs
\ No newline at end of file
+
+    def run_checkpointed(
+        self,
+        total_rounds: int,
+        num_threads: int = 4,
+        seed: int | None = None,
+        checkpoint_rounds: int = 10_000_000,
+        checkpoint_path: str | None = None,
+        resume: SimulationCheckpoint | None = None,
+        on_checkpoint=None
+    ) -> SimAccumulator:
+        """
+        Runs total_rounds in slices of checkpoint_rounds, taking a checkpoint
+        after each slice. The checkpoint is written to checkpoint_path (if given)
+        and passed to on_checkpoint (if given). A run resumes from `resume`, or
+        from an existing file at checkpoint_path, and must match its shoe,
+        rules and round count.
+
+        Raises:
+            ValueError: If the checkpoint belongs to a different run.
+        """
+        if resume is None and checkpoint_path and os.path.exists(checkpoint_path):
+            resume = SimulationCheckpoint.load(checkpoint_path)
+        if resume is not None:
+            if not np.array_equal(resume.shoe_counts, self.shoe_counts) or resume.total_rounds != total_rounds:
+                raise ValueError("Checkpoint does not match this simulator's shoe and round count.")
+            if resume.rules != self.rules:
+                raise ValueError(f"Checkpoint was taken with rules {resume.rules}, not {self.rules}.")
+            if seed is not None and seed != resume.seed:
+                raise ValueError(f"Checkpoint was taken with seed {resume.seed}, not {seed}.")
+            checkpoint = resume
+        else:
+            checkpoint = SimulationCheckpoint(
+                self.shoe_counts, random.getrandbits(63) if seed is None else seed, total_rounds,
+                surrender=self.rules[0], insurance_tc=self.rules[1])
+        self.last_seed = checkpoint.seed
+
+        while not checkpoint.is_complete:
+            rounds = min(checkpoint_rounds, total_rounds - checkpoint.next_round)
+            checkpoint.accumulator.merge(
+                self.run_accumulated(rounds, num_threads, checkpoint.seed, checkpoint.next_round))
+            checkpoint.next_round += rounds
+            if checkpoint_path: checkpoint.save(checkpoint_path)
+            if on_checkpoint: on_checkpoint(checkpoint)
+        return checkpoint.accumulator
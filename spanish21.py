@@ -0,0 +1,272 @@
+"""
+Spanish 21. The shoe has the four tens (not the jacks, queens and kings)
+taken out of every deck, leaving 48 cards per deck. A player 21 always wins
+and a player blackjack beats a dealer blackjack. A 21 on an undoubled hand
+pays a bonus:
+
+  5 cards 3:2, 6 cards 2:1, 7 or more 3:1
+  6-7-8 or 7-7-7 mixed suits 3:2, one suit 2:1, spades 3:1
+
+Late surrender is offered on the first two cards, and after a double the
+player may rescue the hand, forfeiting the original bet and taking back the
+double. The engine runs on simulator.py's scratch shoe and hand-state kernels.
+Like the standard engine, the dealer stands on all 17s, each spot splits once
+and doubles are taken on two cards only. A hand carries its first three card
+indices and its card count, so bonus evaluation is a few integer compares
+with no per-hand arrays.
+
+    python spanish21.py --decks 6 --rounds 10000000
+"""
+from __future__ import annotations
+import argparse
+import json
+import random
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+import shoe
+import simulator
+from numba_utils import (
+    add_card_to_hand, hand_state_total, make_scratch_shoe, make_undo_log,
+    draw_scratch_card_rng, restore_scratch_shoe, rng_stream_state,
+)
+from simulator import BLOCK_ROUNDS, num_blocks, reduce_blocks, _play_dealer_hand, _should_double, _should_split
+
+# Columns of the per-round outcome vector. main_ev is the whole round's result
+# with surrendered and rescued hands at their forfeit; bonus_ev is the part paid
+# above even money on bonus 21s, and the gain columns are what surrender and
+# rescue won over playing those hands out.
+SPANISH_KEYS = ("main_ev", "bonus_ev", "surrender_gain_ev", "rescue_gain_ev")
+NUM_SPANISH_KEYS = len(SPANISH_KEYS)
+SP_MAIN, SP_BONUS, SP_SURRENDER_GAIN, SP_RESCUE_GAIN = range(NUM_SPANISH_KEYS)
+
+# Bonus 21 payouts, and the rank masks of the three-card combinations (rank index = value - 1).
+FIVE_CARD_PAYOUT, SIX_CARD_PAYOUT, SEVEN_CARD_PAYOUT = 1.5, 2.0, 3.0
+MIXED_COMBO_PAYOUT, SUITED_COMBO_PAYOUT, SPADE_COMBO_PAYOUT = 1.5, 2.0, 3.0
+SIX_SEVEN_EIGHT_MASK = (1 << 5) | (1 << 6) | (1 << 7)
+SEVEN_SEVEN_SEVEN_MASK = 1 << 6
+SPADES = 0
+
+def spanish_shoe_counts(decks: int = 6, shoe_counts: np.ndarray | None = None) -> np.ndarray:
+    """A 52-card shoe array (a fresh shoe of `decks` decks by default) with every ten taken out."""
+    if shoe_counts is None:
+        shoe_counts = simulator.FastSimulator(shoe.Shoe(decks=decks).get_remaining_cards()).shoe_counts
+    counts = np.array(shoe_counts, dtype=np.int32)
+    counts[9::13] = 0
+    return counts
+
+@njit(cache=True)
+def _bonus_payout(n_cards: int, c1: int, c2: int, c3: int) -> float:
+    """Payout per unit of an undoubled 21 of n_cards cards whose first three card indices are c1-c3."""
+    if n_cards >= 7: return SEVEN_CARD_PAYOUT
+    if n_cards == 6: return SIX_CARD_PAYOUT
+    if n_cards == 5: return FIVE_CARD_PAYOUT
+    if n_cards != 3: return 1.0
+    mask = (1 << (c1 % 13)) | (1 << (c2 % 13)) | (1 << (c3 % 13))
+    if mask != SIX_SEVEN_EIGHT_MASK and mask != SEVEN_SEVEN_SEVEN_MASK: return 1.0
+    if c1 // 13 != c2 // 13 or c1 // 13 != c3 // 13: return MIXED_COMBO_PAYOUT
+    return SPADE_COMBO_PAYOUT if c1 // 13 == SPADES else SUITED_COMBO_PAYOUT
+
+@njit(cache=True)
+def _spanish_should_stand(player_total: int, is_soft: bool, dealer_up_rank: int, n_cards: int) -> bool:
+    """
+    Standing strategy below 21. Stiff hands of four or more cards keep hitting
+    against 2 to 6, where the next cards can reach a 5-card bonus.
+    """
+    weak_up = 1 <= dealer_up_rank <= 5
+    if is_soft: return player_total >= 19 or (player_total == 18 and 1 <= dealer_up_rank <= 7)
+    if player_total >= 17: return True
+    if player_total >= 15: return weak_up
+    if player_total >= 13: return weak_up and n_cards < 4
+    return player_total == 12 and dealer_up_rank in (3, 4, 5) and n_cards < 4
+
+@njit(cache=True)
+def _spanish_should_surrender(p1_rank: int, p2_rank: int, dealer_up_rank: int) -> bool:
+    """
+    Late surrender of a hard two-card 17 against an Ace. With the tens gone a
+    stiff hand busts less often when it hits, and 15 or 16 against an Ace or a
+    ten plays out better than the half bet surrender keeps.
+    """
+    hard_total, aces = add_card_to_hand(0, 0, p1_rank)
+    hard_total, aces = add_card_to_hand(hard_total, aces, p2_rank)
+    return aces == 0 and hard_total == 17 and dealer_up_rank == 0
+
+@njit(cache=True)
+def _should_rescue(player_total: int, dealer_up_rank: int) -> bool:
+    """Rescues a doubled hand left on a stiff total against 7 or better."""
+    return player_total <= 16 and not 1 <= dealer_up_rank <= 5
+
+@njit(cache=True)
+def _play_spanish_hand(
+    c1: int, c2: int, dealer_up_rank: int, temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, rescue: bool
+) -> tuple[int, float, float, bool]:
+    """
+    Plays a hand from its first two card indices. Returns the final total,
+    the bet multiplier, the payout per unit should the hand be a winning 21
+    (bonus included), and whether a doubled hand was rescued.
+    """
+    hard_total, aces = add_card_to_hand(0, 0, c1 % 13)
+    hard_total, aces = add_card_to_hand(hard_total, aces, c2 % 13)
+    hand_val, is_soft = hand_state_total(hard_total, aces)
+    if hand_val < 21 and _should_double(hand_val, is_soft, dealer_up_rank):
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx != -1: hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+        final_total, _ = hand_state_total(hard_total, aces)
+        return final_total, 2.0, 1.0, rescue and _should_rescue(final_total, dealer_up_rank)
+
+    n_cards, c3 = 2, -1
+    while True:
+        player_total, is_soft = hand_state_total(hard_total, aces)
+        if player_total >= 21 or _spanish_should_stand(player_total, is_soft, dealer_up_rank, n_cards): break
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1: break
+        if n_cards == 2: c3 = card_idx
+        n_cards += 1
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+    return player_total, 1.0, _bonus_payout(n_cards, c1, c2, c3) if player_total == 21 else 1.0, False
+
+@njit(cache=True)
+def _spanish_outcome(player_total: int, dealer_total: int, multiplier: float, payout_21: float) -> float:
+    """Outcome of a played-out hand; a player 21 wins even against a dealer 21."""
+    if player_total > 21: return -multiplier
+    if player_total == 21: return multiplier * payout_21
+    if dealer_total > 21 or player_total > dealer_total: return multiplier
+    if player_total < dealer_total: return -multiplier
+    return 0.0
+
+@njit(cache=True)
+def _settle_spanish_hand(
+    player_total: int, dealer_total: int, multiplier: float, payout_21: float, rescued: bool, row: np.ndarray
+) -> float:
+    """Adds a hand's result to row (a rescued hand at -1) and returns its played-out outcome."""
+    outcome = _spanish_outcome(player_total, dealer_total, multiplier, payout_21)
+    if player_total == 21 and not rescued: row[SP_BONUS] += multiplier * (payout_21 - 1.0)
+    if rescued:
+        row[SP_MAIN] -= 1.0
+        row[SP_RESCUE_GAIN] += -1.0 - outcome
+    else:
+        row[SP_MAIN] += outcome
+    return outcome
+
+@njit(cache=True)
+def _simulate_spanish_round(
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, row: np.ndarray, surrender: bool, rescue: bool
+) -> None:
+    """
+    Plays one Spanish 21 round from the scratch shoe into row (left at 0.0 if
+    the shoe runs dry while dealing). A surrendered hand is still played out on
+    the round's stream, as in simulator._simulate_round, so surrender_gain_ev
+    can compare the two; its bonus and rescue columns are then left at 0.0.
+    """
+    p1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    p2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d_hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if -1 in (p1_idx, p2_idx, d1_idx, d_hole_idx): return
+
+    p1_rank, p2_rank, d_rank = p1_idx % 13, p2_idx % 13, d1_idx % 13
+    p_hard, p_aces = add_card_to_hand(0, 0, p1_rank)
+    p_hard, p_aces = add_card_to_hand(p_hard, p_aces, p2_rank)
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    if hand_state_total(p_hard, p_aces)[0] == 21:
+        row[SP_MAIN] = 1.5
+        return
+    if hand_state_total(d_hard, d_aces)[0] == 21:
+        row[SP_MAIN] = -1.0
+        return
+
+    surrendered = surrender and _spanish_should_surrender(p1_rank, p2_rank, d_rank)
+    t2, m2, pay2, rescued2 = 0, 0.0, 1.0, False
+    if p1_rank == p2_rank and _should_split(p1_rank, d_rank):
+        h1_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        h2_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if h1_card_idx == -1 or h2_card_idx == -1: return
+        t1, m1, pay1, rescued1 = _play_spanish_hand(p1_idx, h1_card_idx, d_rank, temp_shoe, undo_log, rng, rescue)
+        t2, m2, pay2, rescued2 = _play_spanish_hand(p2_idx, h2_card_idx, d_rank, temp_shoe, undo_log, rng, rescue)
+    else:
+        t1, m1, pay1, rescued1 = _play_spanish_hand(p1_idx, p2_idx, d_rank, temp_shoe, undo_log, rng, rescue)
+
+    dealer_final, _ = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+    played = _settle_spanish_hand(t1, dealer_final, m1, pay1, rescued1, row)
+    if m2 > 0.0: played += _settle_spanish_hand(t2, dealer_final, m2, pay2, rescued2, row)
+    if surrendered:
+        row[:] = 0.0
+        row[SP_MAIN], row[SP_SURRENDER_GAIN] = -0.5, -0.5 - played
+
+@njit(cache=True)
+def _accumulate_spanish_rounds(
+    shoe_counts: np.ndarray, seed: int, lo: int, hi: int, out: np.ndarray, surrender: bool, rescue: bool
+) -> None:
+    """Plays rounds [lo, hi) into out's outcome sums and squares, as simulator._accumulate_rounds."""
+    rng = np.zeros(1, dtype=np.uint64)
+    row = np.zeros(NUM_SPANISH_KEYS, dtype=np.float64)
+    temp_shoe = make_scratch_shoe(shoe_counts)
+    undo_log = make_undo_log()
+    for i in range(lo, hi):
+        rng[0] = rng_stream_state(seed, i)
+        row[:] = 0.0
+        _simulate_spanish_round(temp_shoe, undo_log, rng, row, surrender, rescue)
+        restore_scratch_shoe(temp_shoe, undo_log)
+        for k in range(NUM_SPANISH_KEYS):
+            out[0, k] += row[k]
+            out[1, k] += row[k] * row[k]
+
+@njit(parallel=True)
+def simulate_spanish_chunk(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int, block_rounds: int = BLOCK_ROUNDS,
+    surrender: bool = True, rescue: bool = True
+) -> np.ndarray:
+    """
+    Spanish 21 counterpart of simulator.simulate_chunk: a (2, NUM_SPANISH_KEYS)
+    array of outcome sums and sums of squares for rounds [start_round,
+    start_round + rounds), independent of how the range is partitioned.
+    shoe_counts is normally a spanish_shoe_counts array.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial = np.zeros((max(n_blocks, 1), 2, NUM_SPANISH_KEYS), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            lo = start_round + (rounds * b) // n_blocks
+            hi = start_round + (rounds * (b + 1)) // n_blocks
+            _accumulate_spanish_rounds(shoe_counts, seed, lo, hi, partial[b], surrender, rescue)
+    return reduce_blocks(partial)
+
+def simulate_spanish21(
+    decks: int = 6,
+    rounds: int = 1_000_000,
+    num_threads: int = 4,
+    seed: int | None = None,
+    surrender: bool = True,
+    rescue: bool = True,
+    shoe_counts: np.ndarray | None = None
+) -> dict:
+    """
+    Mean and standard error of every SPANISH_KEYS column over `rounds` rounds
+    dealt from shoe_counts (a fresh Spanish shoe of `decks` decks by default).
+    """
+    if shoe_counts is None: shoe_counts = spanish_shoe_counts(decks)
+    seed = random.getrandbits(63) if seed is None else seed
+
+    result = {"rounds": rounds, "seed": seed, "cards": int(np.sum(shoe_counts))}
+    result.update(simulator.run_engine(simulate_spanish_chunk,
+                                       (shoe_counts, rounds, seed, 0, BLOCK_ROUNDS, surrender, rescue),
+                                       rounds, SPANISH_KEYS, num_threads))
+    return result
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Simulate Spanish 21.")
+    parser.add_argument("--decks", type=int, default=6)
+    parser.add_argument("--rounds", type=int, default=1_000_000)
+    parser.add_argument("--threads", type=int, default=4)
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--no-surrender", action="store_true", help="Play without late surrender.")
+    parser.add_argument("--no-rescue", action="store_true", help="Play without double-down rescue.")
+    args = parser.parse_args(argv)
+    print(json.dumps(simulate_spanish21(args.decks, args.rounds, args.threads, args.seed,
+                                        not args.no_surrender, not args.no_rescue), indent=2))
+
+if __name__ == "__main__":
+    main()
@@ -4,6 +4,7 @@ EV simulations, and Bayesian predictions. This module focuses on betting strateg
 and overall game-state awareness, including Kelly Criterion bet sizing.
 """
 from __future__ import annotations
+import math
 from typing import TYPE_CHECKING
 
 if TYPE_CHECKING:
@@ -11,6 +12,35 @@ if TYPE_CHECKING:
     from counting import CountingSystem
 
 import bayesian_predictor
+from tracing import TRACER
+
+def risk_of_ruin(ev_per_round: float, std_per_round: float, bankroll_units: float) -> float:
+    """
+    Classic diffusion approximation of the risk of ruin for flat betting one
+    unit per round: exp(-2 * EV * bankroll / variance). Non-positive EV is
+    certain ruin.
+    """
+    if ev_per_round <= 0: return 1.0
+    if std_per_round <= 0: return 0.0
+    return math.exp(-2.0 * ev_per_round * bankroll_units / (std_per_round ** 2))
+
+def bankroll_for_risk(ev_per_round: float, std_per_round: float, target_ror: float) -> float:
+    """Bankroll (in betting units) needed to keep the risk of ruin at target_ror."""
+    if ev_per_round <= 0: return math.inf
+    return -math.log(target_ror) * (std_per_round ** 2) / (2.0 * ev_per_round)
+
+def kelly_spot_fraction(ev_per_spot: float, variance_per_spot: float, covariance: float, spots: int) -> float:
+    """
+    Kelly fraction of bankroll to bet on each of `spots` equal bets with the
+    given per-spot EV, variance and pairwise covariance (see
+    FastSimulator.run_spots): EV / (variance + (spots - 1) * covariance).
+    Spots at one table are positively correlated through the shared dealer
+    hand, so treating them as independent overbets. cli.py's "spots" job
+    reports this sizing.
+    """
+    if ev_per_spot <= 0: return 0.0
+    denominator = variance_per_spot + (spots - 1) * covariance
+    return ev_per_spot / denominator if denominator > 0 else 0.0
 
 class StrategyAdvisor:
     """
@@ -24,7 +54,8 @@ class StrategyAdvisor:
             'sidebet_threshold': 0.0,
             'dealer_bust_alert_threshold': 0.40,
             'kelly_fraction': 0.5,
-            'kelly_fraction_name': 'Half'
+            'kelly_fraction_name': 'Half',
+            'exit_policy': None
         }
 
     def generate_recommendations(
@@ -52,10 +83,17 @@ class StrategyAdvisor:
             recommendations.append(f"Optimal Bet ({kelly_name} Kelly): Bet {bet_pct:.2f}% of bankroll.")
         else:
             recommendations.append(f"Player Advantage: {advantage_pct:+.2f}%. No edge. Bet table minimum.")
+
+        # --- Table Exit (optional precomputed policy, see exit_policy.py) ---
+        exit_policy = self.config.get('exit_policy')
+        if exit_policy is not None and "Hi-Lo" in counters:
+            true_count = counters["Hi-Lo"].true_count(shoe.decks_remaining())
+            recommendations.append(f"Table: {exit_policy.advice(true_count, shoe.get_penetration())}")
         
         # --- Side Bet Analysis ---
         recommendations.append("\n--- Side Bet Analysis (Composition-Dependent EV) ---")
-        immediate_evs = bayesian_predictor.run_side_bet_simulation(shoe, num_rounds=25000)
+        with TRACER.stage("side_bet_simulation"):
+            immediate_evs = bayesian_predictor.run_side_bet_simulation(shoe, num_rounds=25000)
         side_bets = {
             "21+3": immediate_evs.get("21+3_ev", 0.0),
             "Perfect Pairs": immediate_evs.get("perfect_pairs_ev", 0.0),
@@ -79,13 +117,15 @@ class StrategyAdvisor:
         shoe_cards = shoe.get_remaining_cards()
         
         # 1. Top 5 Exact Cards
-        top_cards = bayesian_predictor.next_card_probabilities(shoe_cards, top_n=5)
+        with TRACER.stage("next_card_probabilities"):
+            top_cards = bayesian_predictor.next_card_probabilities(shoe_cards, top_n=5)
         if top_cards:
             card_preds = [f"{c} ({p:.1%})" for c, p in top_cards]
             recommendations.append(f"Top 5 Cards: {', '.join(card_preds)}")
 
         # 2. Rank Distribution
-        rank_dist = bayesian_predictor.rank_distribution_probabilities(shoe_cards)
+        with TRACER.stage("rank_distribution"):
+            rank_dist = bayesian_predictor.rank_distribution_probabilities(shoe_cards)
         if rank_dist:
             dist_preds = [f"{name}: {p:.1%}" for name, p in rank_dist.items()]
             recommendations.append(f"Rank Dist: {', '.join(dist_preds)}")
@@ -93,7 +133,8 @@ class StrategyAdvisor:
                  recommendations.append("Insight: Shoe is rich in 10-value cards.")
 
         # 3. Suit Distribution
-        suit_dist = bayesian_predictor.next_suit_probabilities(shoe_cards)
+        with TRACER.stage("suit_distribution"):
+            suit_dist = bayesian_predictor.next_suit_probabilities(shoe_cards)
         if suit_dist:
             suit_preds = [f"{s} ({p:.1%})" for s, p in suit_dist.items()]
             recommendations.append(f"Suit Dist: {', '.join(suit_preds)}")
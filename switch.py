@@ -0,0 +1,303 @@
+"""
+Blackjack Switch. The player plays two hands of one unit each and, once the
+dealer has checked for blackjack, may switch the second cards of the two
+hands. A blackjack pays even money, and a dealer 22 pushes every other hand
+still standing.
+
+The swap decision uses a table of two-card hand EVs for each upcard, built once
+per shoe composition from the exact dealer distribution of
+free_bet.dealer_distribution. Each round then compares the dealt pairing with
+the switched one using four lookups. The same calculation gives the
+stand/hit/double and split tables the hands are played by. It treats player
+draws as made with replacement from the shoe's rank composition, which is
+accurate for a multi-deck shoe. Like the other engines, the dealer stands on
+all 17s and each hand splits once.
+
+    python switch.py --decks 6 --rounds 100000000
+"""
+from __future__ import annotations
+import argparse
+import json
+import random
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+import shoe
+import simulator
+from free_bet import DEALER_BUST, NUM_CATEGORIES, dealer_distribution, rank_categories
+from indices import ACTION_DOUBLE, ACTION_HIT, ACTION_STAND
+from numba_utils import (
+    add_card_to_hand, hand_state_total, make_scratch_shoe, make_undo_log,
+    draw_scratch_card_rng, restore_scratch_shoe, rng_stream_state,
+)
+from simulator import BLOCK_ROUNDS, num_blocks, reduce_blocks, _play_dealer_hand
+
+# Columns of the per-round outcome vector. main_ev is the result of both hands
+# together; switch_rate is 1.0 for a round in which the cards were switched and
+# expected_switch_gain is the gain the hand EV table credited that switch with.
+SWITCH_KEYS = ("main_ev", "switch_rate", "expected_switch_gain")
+NUM_SWITCH_KEYS = len(SWITCH_KEYS)
+SW_MAIN, SW_SWITCHED, SW_EXPECTED_GAIN = range(NUM_SWITCH_KEYS)
+
+MAX_HARD_TOTAL = 21
+
+class SwitchTables:
+    """
+    Cached strategy for one shoe composition, indexed by dealer upcard
+    category (0 for an Ace, 9 for a ten):
+
+      hand_ev     [up, c1, c2] EV of a two-card starting hand played by these tables
+      play_two    [soft, hard total, up] ACTION_* for a two-card hand
+      play_more   [soft, hard total, up] ACTION_STAND or ACTION_HIT from three cards on
+      split_pairs [pair, up] whether a pair is split
+    """
+    def __init__(self, shoe_counts: np.ndarray):
+        self.hand_ev = np.zeros((NUM_CATEGORIES, NUM_CATEGORIES, NUM_CATEGORIES), dtype=np.float64)
+        self.play_two = np.full((2, MAX_HARD_TOTAL + 1, NUM_CATEGORIES), ACTION_STAND, dtype=np.int64)
+        self.play_more = np.full((2, MAX_HARD_TOTAL + 1, NUM_CATEGORIES), ACTION_STAND, dtype=np.int64)
+        self.split_pairs = np.zeros((NUM_CATEGORIES, NUM_CATEGORIES), dtype=np.bool_)
+        categories = rank_categories(shoe_counts)
+        for up in range(NUM_CATEGORIES):
+            if categories[up] == 0: continue
+            counts = categories.copy()
+            counts[up] -= 1
+            self._solve_upcard(up, counts / counts.sum(), dealer_distribution(counts, up, True))
+
+    def _solve_upcard(self, up: int, draw_probs: np.ndarray, dealer: np.ndarray) -> None:
+        """Fills every table's entries for one upcard from the draw probabilities and the dealer's outcomes."""
+        def stand(total: int) -> float:
+            if total > MAX_HARD_TOTAL: return -1.0
+            win = dealer[DEALER_BUST] + sum(dealer[d - 17] for d in range(17, min(total, 22)))
+            lose = sum(dealer[d - 17] for d in range(max(total + 1, 17), 22))
+            return float(win - lose)
+
+        def total_of(hard: int, soft: int) -> int:
+            return hard + 10 if soft and hard + 10 <= 21 else hard
+
+        def draws(hard: int, soft: int):
+            for c in range(NUM_CATEGORIES):
+                if draw_probs[c] > 0.0: yield draw_probs[c], hard + c + 1, 1 if soft or c == 0 else 0
+
+        # Best EV of a hand of three or more cards, filled from high hard totals down.
+        best = np.full((2, MAX_HARD_TOTAL + 1), -1.0)
+        for hard in range(MAX_HARD_TOTAL, 1, -1):
+            for soft in (0, 1):
+                hit = sum(p * (best[s, h] if h <= MAX_HARD_TOTAL else -1.0) for p, h, s in draws(hard, soft))
+                stand_ev = stand(total_of(hard, soft))
+                if total_of(hard, soft) < 21 and hit > stand_ev: self.play_more[soft, hard, up] = ACTION_HIT
+                best[soft, hard] = max(stand_ev, hit) if total_of(hard, soft) < 21 else stand_ev
+
+        two_card = np.full((2, MAX_HARD_TOTAL + 1), -1.0)
+        for hard in range(2, MAX_HARD_TOTAL + 1):
+            for soft in (0, 1):
+                options = {
+                    ACTION_STAND: stand(total_of(hard, soft)),
+                    ACTION_HIT: sum(p * (best[s, h] if h <= MAX_HARD_TOTAL else -1.0) for p, h, s in draws(hard, soft)),
+                    ACTION_DOUBLE: 2.0 * sum(p * stand(total_of(h, s)) for p, h, s in draws(hard, soft)),
+                }
+                if total_of(hard, soft) == 21: options = {ACTION_STAND: options[ACTION_STAND]}
+                action = max(options, key=options.get)
+                self.play_two[soft, hard, up] = action
+                two_card[soft, hard] = options[action]
+
+        for c1 in range(NUM_CATEGORIES):
+            for c2 in range(NUM_CATEGORIES):
+                hard, soft = c1 + c2 + 2, 1 if 0 in (c1, c2) else 0
+                ev = 1.0 if total_of(hard, soft) == 21 else two_card[soft, hard]
+                if c1 == c2:
+                    split_ev = 2.0 * sum(p * two_card[s, h] for p, h, s in draws(c1 + 1, 1 if c1 == 0 else 0))
+                    if split_ev > ev:
+                        self.split_pairs[c1, up] = True
+                        ev = split_ev
+                self.hand_ev[up, c1, c2] = ev
+
+@njit(cache=True)
+def _category(card_idx: int) -> int:
+    """Rank category of a card index or rank: 0 for an Ace, 1-8 for 2-9, 9 for any ten."""
+    return min(card_idx % 13, 9)
+
+@njit(cache=True)
+def _play_switch_hand(
+    hard_total: int, aces: int, up: int, play_two: np.ndarray, play_more: np.ndarray,
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray
+) -> tuple[int, float]:
+    """Plays a two-card hand by the tables and returns its final total and bet multiplier."""
+    action = play_two[1 if aces > 0 else 0, hard_total, up]
+    if action == ACTION_DOUBLE:
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx != -1: hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+        return hand_state_total(hard_total, aces)[0], 2.0
+
+    hit = action == ACTION_HIT
+    while hit:
+        card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if card_idx == -1: break
+        hard_total, aces = add_card_to_hand(hard_total, aces, card_idx % 13)
+        if hard_total > 21 or hand_state_total(hard_total, aces)[0] == 21: break
+        hit = play_more[1 if aces > 0 else 0, hard_total, up] == ACTION_HIT
+    return hand_state_total(hard_total, aces)[0], 1.0
+
+@njit(cache=True)
+def _play_switch_spot(
+    r1: int, r2: int, up: int, play_two: np.ndarray, play_more: np.ndarray, split_pairs: np.ndarray,
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray
+) -> tuple[int, float, int, float]:
+    """One starting hand, split once if the table says so; returns as simulator._play_spot."""
+    c1 = _category(r1)
+    if c1 == _category(r2) and split_pairs[c1, up]:
+        h1_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        h2_card_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+        if h1_card_idx == -1 or h2_card_idx == -1: return 0, 0.0, 0, 0.0
+        hard_total, aces = add_card_to_hand(0, 0, r1)
+        hard_total, aces = add_card_to_hand(hard_total, aces, h1_card_idx % 13)
+        t1, m1 = _play_switch_hand(hard_total, aces, up, play_two, play_more, temp_shoe, undo_log, rng)
+        hard_total, aces = add_card_to_hand(0, 0, r2)
+        hard_total, aces = add_card_to_hand(hard_total, aces, h2_card_idx % 13)
+        t2, m2 = _play_switch_hand(hard_total, aces, up, play_two, play_more, temp_shoe, undo_log, rng)
+        return t1, m1, t2, m2
+    hard_total, aces = add_card_to_hand(0, 0, r1)
+    hard_total, aces = add_card_to_hand(hard_total, aces, r2)
+    t1, m1 = _play_switch_hand(hard_total, aces, up, play_two, play_more, temp_shoe, undo_log, rng)
+    return t1, m1, 0, 0.0
+
+@njit(cache=True)
+def _switch_outcome(player_total: int, dealer_total: int, multiplier: float) -> float:
+    """Outcome of a finished hand; a dealer 22 pushes it unless it busted."""
+    if player_total > 21: return -multiplier
+    if dealer_total == 22: return 0.0
+    if dealer_total > 21 or player_total > dealer_total: return multiplier
+    if player_total < dealer_total: return -multiplier
+    return 0.0
+
+@njit(cache=True)
+def _is_blackjack(r1: int, r2: int) -> bool:
+    hard_total, aces = add_card_to_hand(0, 0, r1)
+    hard_total, aces = add_card_to_hand(hard_total, aces, r2)
+    return hand_state_total(hard_total, aces)[0] == 21
+
+@njit(cache=True)
+def _simulate_switch_round(
+    temp_shoe: np.ndarray, undo_log: np.ndarray, rng: np.ndarray, row: np.ndarray, allow_switch: bool,
+    hand_ev: np.ndarray, play_two: np.ndarray, play_more: np.ndarray, split_pairs: np.ndarray
+) -> None:
+    """
+    Plays one round of two hands into row (left at 0.0 if the shoe runs dry
+    while dealing). A dealer blackjack settles the hands as dealt; otherwise
+    the second cards are switched when the hand EV table favours it.
+    """
+    a1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    b1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d1_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    a2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    b2_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    d_hole_idx = draw_scratch_card_rng(temp_shoe, undo_log, rng)
+    if -1 in (a1_idx, b1_idx, d1_idx, a2_idx, b2_idx, d_hole_idx): return
+
+    a1, b1, a2, b2, d_rank = a1_idx % 13, b1_idx % 13, a2_idx % 13, b2_idx % 13, d1_idx % 13
+    if _is_blackjack(d_rank, d_hole_idx % 13):
+        row[SW_MAIN] = (0.0 if _is_blackjack(a1, a2) else -1.0) + (0.0 if _is_blackjack(b1, b2) else -1.0)
+        return
+
+    up = _category(d_rank)
+    keep = hand_ev[up, _category(a1), _category(a2)] + hand_ev[up, _category(b1), _category(b2)]
+    switched = hand_ev[up, _category(a1), _category(b2)] + hand_ev[up, _category(b1), _category(a2)]
+    if allow_switch and switched > keep:
+        a2, b2 = b2, a2
+        row[SW_SWITCHED] = 1.0
+        row[SW_EXPECTED_GAIN] = switched - keep
+
+    ta1, ma1, ta2, ma2, tb1, mb1, tb2, mb2 = 0, 0.0, 0, 0.0, 0, 0.0, 0, 0.0
+    if _is_blackjack(a1, a2): row[SW_MAIN] += 1.0
+    else: ta1, ma1, ta2, ma2 = _play_switch_spot(a1, a2, up, play_two, play_more, split_pairs, temp_shoe, undo_log, rng)
+    if _is_blackjack(b1, b2): row[SW_MAIN] += 1.0
+    else: tb1, mb1, tb2, mb2 = _play_switch_spot(b1, b2, up, play_two, play_more, split_pairs, temp_shoe, undo_log, rng)
+
+    d_hard, d_aces = add_card_to_hand(0, 0, d_rank)
+    d_hard, d_aces = add_card_to_hand(d_hard, d_aces, d_hole_idx % 13)
+    dealer_final, _ = _play_dealer_hand(d_hard, d_aces, 2, temp_shoe, undo_log, rng, None)
+    if ma1 > 0.0: row[SW_MAIN] += _switch_outcome(ta1, dealer_final, ma1)
+    if ma2 > 0.0: row[SW_MAIN] += _switch_outcome(ta2, dealer_final, ma2)
+    if mb1 > 0.0: row[SW_MAIN] += _switch_outcome(tb1, dealer_final, mb1)
+    if mb2 > 0.0: row[SW_MAIN] += _switch_outcome(tb2, dealer_final, mb2)
+
+@njit(cache=True)
+def _accumulate_switch_rounds(
+    shoe_counts: np.ndarray, seed: int, lo: int, hi: int, out: np.ndarray, allow_switch: bool,
+    hand_ev: np.ndarray, play_two: np.ndarray, play_more: np.ndarray, split_pairs: np.ndarray
+) -> None:
+    """Plays rounds [lo, hi) into out's outcome sums and squares, as simulator._accumulate_rounds."""
+    rng = np.zeros(1, dtype=np.uint64)
+    row = np.zeros(NUM_SWITCH_KEYS, dtype=np.float64)
+    temp_shoe = make_scratch_shoe(shoe_counts)
+    undo_log = make_undo_log()
+    for i in range(lo, hi):
+        rng[0] = rng_stream_state(seed, i)
+        row[:] = 0.0
+        _simulate_switch_round(temp_shoe, undo_log, rng, row, allow_switch, hand_ev, play_two, play_more, split_pairs)
+        restore_scratch_shoe(temp_shoe, undo_log)
+        for k in range(NUM_SWITCH_KEYS):
+            out[0, k] += row[k]
+            out[1, k] += row[k] * row[k]
+
+@njit(parallel=True)
+def simulate_switch_chunk(
+    shoe_counts: np.ndarray, rounds: int, seed: int, start_round: int,
+    hand_ev: np.ndarray, play_two: np.ndarray, play_more: np.ndarray, split_pairs: np.ndarray,
+    allow_switch: bool = True, block_rounds: int = BLOCK_ROUNDS
+) -> np.ndarray:
+    """
+    Blackjack Switch counterpart of simulator.simulate_chunk: a (2,
+    NUM_SWITCH_KEYS) array of outcome sums and sums of squares for rounds
+    [start_round, start_round + rounds), played by a SwitchTables' arrays.
+    allow_switch=False plays the same rounds as dealt, for measuring the
+    switch's value on common random numbers.
+    """
+    n_blocks = num_blocks(rounds, block_rounds)
+    partial = np.zeros((max(n_blocks, 1), 2, NUM_SWITCH_KEYS), dtype=np.float64)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            lo = start_round + (rounds * b) // n_blocks
+            hi = start_round + (rounds * (b + 1)) // n_blocks
+            _accumulate_switch_rounds(shoe_counts, seed, lo, hi, partial[b], allow_switch,
+                                      hand_ev, play_two, play_more, split_pairs)
+    return reduce_blocks(partial)
+
+def simulate_switch(
+    decks: int = 6,
+    rounds: int = 1_000_000,
+    num_threads: int = 4,
+    seed: int | None = None,
+    allow_switch: bool = True,
+    shoe_counts: np.ndarray | None = None
+) -> dict:
+    """
+    Mean and standard error of every SWITCH_KEYS column over `rounds` rounds
+    of two hands dealt from shoe_counts (a fresh shoe of `decks` decks by
+    default). main_ev is per round, i.e. for two units wagered.
+    """
+    if shoe_counts is None:
+        shoe_counts = simulator.FastSimulator(shoe.Shoe(decks=decks).get_remaining_cards()).shoe_counts
+    seed = random.getrandbits(63) if seed is None else seed
+    tables = SwitchTables(shoe_counts)
+
+    result = {"rounds": rounds, "seed": seed, "allow_switch": allow_switch}
+    result.update(simulator.run_engine(simulate_switch_chunk,
+                                       (shoe_counts, rounds, seed, 0, tables.hand_ev, tables.play_two,
+                                        tables.play_more, tables.split_pairs, allow_switch),
+                                       rounds, SWITCH_KEYS, num_threads))
+    return result
+
+def main(argv: list[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(description="Simulate Blackjack Switch.")
+    parser.add_argument("--decks", type=int, default=6)
+    parser.add_argument("--rounds", type=int, default=1_000_000)
+    parser.add_argument("--threads", type=int, default=4)
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--no-switch", action="store_true", help="Play the hands as dealt.")
+    args = parser.parse_args(argv)
+    print(json.dumps(simulate_switch(args.decks, args.rounds, args.threads, args.seed, not args.no_switch), indent=2))
+
+if __name__ == "__main__":
+    main()
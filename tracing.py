@@ -0,0 +1,117 @@
+"""
+Lightweight, thread-safe tracing for the advice pipeline. Stages are timed
+with `with TRACER.stage("name"):` and recorded into fixed-bucket latency
+histograms; plain event counters are kept alongside. The collected data can
+be formatted as a text table (shown in the GUI's timing panel), returned as a
+dict, or dumped to JSON (the panel's Save Timing button).
+"""
+from __future__ import annotations
+import json
+import threading
+import time
+from contextlib import contextmanager
+
+# Upper bounds (milliseconds) of the latency histogram buckets; the last bucket is unbounded.
+BUCKET_BOUNDS_MS = (0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, float("inf"))
+
+class StageStats:
+    """Latency histogram and summary statistics for one stage."""
+    def __init__(self):
+        self.count = 0
+        self.total_ms = 0.0
+        self.min_ms = float("inf")
+        self.max_ms = 0.0
+        self.last_ms = 0.0
+        self.buckets = [0] * len(BUCKET_BOUNDS_MS)
+
+    def record(self, ms: float) -> None:
+        self.count += 1
+        self.total_ms += ms
+        self.min_ms = min(self.min_ms, ms)
+        self.max_ms = max(self.max_ms, ms)
+        self.last_ms = ms
+        for i, bound in enumerate(BUCKET_BOUNDS_MS):
+            if ms <= bound:
+                self.buckets[i] += 1
+                break
+
+    def percentile(self, q: float) -> float:
+        """Upper bound of the bucket holding the q-th percentile (capped at the observed max)."""
+        if self.count == 0: return 0.0
+        target = q / 100.0 * self.count
+        seen = 0
+        for bound, n in zip(BUCKET_BOUNDS_MS, self.buckets):
+            seen += n
+            if seen >= target: return min(bound, self.max_ms)
+        return self.max_ms
+
+    def to_dict(self) -> dict:
+        return {
+            "count": self.count,
+            "mean_ms": self.total_ms / self.count if self.count else 0.0,
+            "min_ms": self.min_ms if self.count else 0.0,
+            "max_ms": self.max_ms,
+            "last_ms": self.last_ms,
+            "p50_ms": self.percentile(50),
+            "p99_ms": self.percentile(99),
+            "histogram": {("inf" if b == float("inf") else f"{b:g}"): n for b, n in zip(BUCKET_BOUNDS_MS, self.buckets)},
+        }
+
+class Tracer:
+    """Collects per-stage latency histograms and named counters."""
+    def __init__(self, enabled: bool = True):
+        self.enabled = enabled
+        self._stages: dict[str, StageStats] = {}
+        self._counters: dict[str, int] = {}
+        self._lock = threading.Lock()
+
+    @contextmanager
+    def stage(self, name: str):
+        """Times the enclosed block as one sample of stage `name`."""
+        if not self.enabled:
+            yield
+            return
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.record(name, (time.perf_counter() - start) * 1000.0)
+
+    def record(self, name: str, ms: float) -> None:
+        with self._lock:
+            self._stages.setdefault(name, StageStats()).record(ms)
+
+    def count(self, name: str, n: int = 1) -> None:
+        if not self.enabled: return
+        with self._lock:
+            self._counters[name] = self._counters.get(name, 0) + n
+
+    def reset(self) -> None:
+        with self._lock:
+            self._stages.clear()
+            self._counters.clear()
+
+    def snapshot(self) -> dict:
+        with self._lock:
+            return {
+                "stages": {name: stats.to_dict() for name, stats in self._stages.items()},
+                "counters": dict(self._counters),
+            }
+
+    def dump(self, path: str) -> None:
+        with open(path, "w") as f:
+            json.dump(self.snapshot(), f, indent=2)
+
+    def format_table(self) -> str:
+        """Fixed-width summary of every stage, slowest p99 first, followed by the counters."""
+        data = self.snapshot()
+        lines = [f"{'Stage':<28}{'n':>6}{'last':>9}{'mean':>9}{'p50':>9}{'p99':>9}{'max':>9}  (ms)"]
+        for name, s in sorted(data["stages"].items(), key=lambda item: -item[1]["p99_ms"]):
+            lines.append(f"{name:<28}{s['count']:>6}{s['last_ms']:>9.2f}{s['mean_ms']:>9.2f}"
+                         f"{s['p50_ms']:>9.2f}{s['p99_ms']:>9.2f}{s['max_ms']:>9.2f}")
+        if data["counters"]:
+            lines.append("")
+            lines.extend(f"{name:<28}{n:>6}" for name, n in sorted(data["counters"].items()))
+        return "\n".join(lines)
+
+TRACER = Tracer()
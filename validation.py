@@ -0,0 +1,420 @@
+"""
+Statistical correctness suite for the simulation kernels. Simulated EVs from
+FastSimulator and run_side_bet_simulation are compared against exact values
+computed by independent pure-Python references, for many shoe compositions.
+
+The references play the kernel's documented rules (stand on all 17s, the
+simplified split/double strategy, the simplified bust and Hot 3 payouts, and
+optionally late or early surrender and count-based insurance) and enumerate
+every possible deal:
+
+  * Side bets are enumerated card by card over the first three cards, using
+    the payouts in sidebets.py.
+  * The main bet, the dealer bust bet and the surrender and insurance
+    columns are enumerated over every draw sequence of the round. This is exponential in the number of distinct card
+    values, so it runs on reduced shoes made of three or four values.
+
+A simulated mean passes if it lies within z standard errors of the exact
+value, with the standard error taken from the exact variance. The suite also
+checks that totals are bit-identical however a run is split into blocks and
+start_round slices. Any kernel performance change should keep it passing.
+
+    python validation.py               # full suite, exit status 1 on failure
+    python validation.py --quick       # fewer compositions
+"""
+from __future__ import annotations
+import argparse
+import math
+import random
+import sys
+
+import numpy as np
+
+import bayesian_predictor
+import shoe
+import simulator
+from sidebets import PAYOUT_21PLUS3, PAYOUT_PERFECT_PAIRS, PAYOUT_HOT3
+
+TEN_CATEGORY = 9
+VALUE_NAMES = ["A", "2", "3", "4", "5", "6", "7", "8", "9", "10"]
+HILO_TAGS = [-1, 1, 1, 1, 1, 1, 0, 0, 0, -1]
+MAIN_GAME_BETS = ("main_ev", "bust_ev", "surrender_gain_ev", "insurance_ev", "even_money_ev")
+
+# Surrender rule and insurance true count for the rule checks; the reduced shoes
+# are ten-rich, so a threshold of 3 insures most Ace upcards but not all.
+RULE_CASES = (("late", 3.0), ("early", 3.0))
+
+# --- Exact side-bet reference (card level) ---
+
+def _ref_21plus3(ranks: tuple[int, int, int], suits: tuple[int, int, int]) -> float:
+    is_flush = suits[0] == suits[1] == suits[2]
+    unique_ranks = sorted(set(ranks))
+    is_three_kind = len(unique_ranks) == 1
+    is_straight = (len(unique_ranks) == 3 and unique_ranks[2] - unique_ranks[0] == 2) or \
+                  unique_ranks == [0, 11, 12]
+    if is_three_kind and is_flush: return PAYOUT_21PLUS3["suited_trips"]
+    if is_straight and is_flush: return PAYOUT_21PLUS3["straight_flush"]
+    if is_three_kind: return PAYOUT_21PLUS3["three_kind"]
+    if is_straight: return PAYOUT_21PLUS3["straight"]
+    if is_flush: return PAYOUT_21PLUS3["flush"]
+    return -1.0
+
+def _ref_perfect_pairs(ranks: tuple[int, int], suits: tuple[int, int]) -> float:
+    if ranks[0] != ranks[1]: return -1.0
+    if suits[0] == suits[1]: return PAYOUT_PERFECT_PAIRS["perfect_pair"]
+    same_colour = (suits[0] in (1, 2)) == (suits[1] in (1, 2))
+    return PAYOUT_PERFECT_PAIRS["colored_pair"] if same_colour else PAYOUT_PERFECT_PAIRS["mixed_pair"]
+
+def _ref_hot3(ranks: tuple[int, int, int]) -> float:
+    """Hot 3 without the suited upgrades, which the kernels do not simulate."""
+    if ranks == (6, 6, 6): return PAYOUT_HOT3["777"]
+    total = _hand_total([_rank_category(r) for r in ranks])[0]
+    if total in (19, 20, 21): return PAYOUT_HOT3[str(total)]
+    return -1.0
+
+def exact_side_bets(shoe_counts: np.ndarray) -> dict[str, tuple[float, float]]:
+    """
+    Exact (mean, variance) of each side bet for the first three cards dealt
+    from a 52-element shoe-count array (index = suit * 13 + rank).
+    """
+    counts = [int(c) for c in shoe_counts]
+    n = sum(counts)
+    moments = {key: [0.0, 0.0] for key in ("21+3_ev", "perfect_pairs_ev", "hot3_ev")}
+    if n < 3: return {key: (0.0, 0.0) for key in moments}
+    denominator = n * (n - 1) * (n - 2)
+
+    for a in range(52):
+        if counts[a] == 0: continue
+        wa = counts[a]; counts[a] -= 1
+        for b in range(52):
+            if counts[b] == 0: continue
+            wb = counts[b]; counts[b] -= 1
+            for d in range(52):
+                if counts[d] == 0: continue
+                p = wa * wb * counts[d] / denominator
+                ranks, suits = (a % 13, b % 13, d % 13), (a // 13, b // 13, d // 13)
+                for key, value in (
+                    ("21+3_ev", _ref_21plus3(ranks, suits)),
+                    ("perfect_pairs_ev", _ref_perfect_pairs(ranks[:2], suits[:2])),
+                    ("hot3_ev", _ref_hot3(ranks)),
+                ):
+                    moments[key][0] += p * value
+                    moments[key][1] += p * value * value
+            counts[b] += 1
+        counts[a] += 1
+    return {key: (m, max(m2 - m * m, 0.0)) for key, (m, m2) in moments.items()}
+
+# --- Exact main-game reference (value level) ---
+
+def _rank_category(rank: int) -> int:
+    return TEN_CATEGORY if rank >= 9 else rank
+
+def _hand_total(hand: list[int]) -> tuple[int, bool]:
+    """Mirrors numba_utils.get_hand_total, including its soft-flag semantics."""
+    total = sum(11 if c == 0 else (10 if c == TEN_CATEGORY else c + 1) for c in hand)
+    aces = hand.count(0)
+    is_soft = False
+    if aces > 0:
+        effective_aces = aces
+        while total > 21 and effective_aces > 0:
+            total -= 10
+            effective_aces -= 1
+        is_soft = total <= 21
+    return total, is_soft
+
+class _NeedDraw(Exception):
+    pass
+
+class _ScriptedDraws:
+    """Replays a fixed prefix of draws and records the path probability."""
+    def __init__(self, counts: list[int], script: tuple[int, ...]):
+        self.remaining = list(counts)
+        self.script = script
+        self.position = 0
+        self.probability = 1.0
+
+    def __call__(self) -> int:
+        if self.position == len(self.script): raise _NeedDraw
+        category = self.script[self.position]
+        self.position += 1
+        if category == -1: return -1
+        self.probability *= self.remaining[category] / sum(self.remaining)
+        self.remaining[category] -= 1
+        return category
+
+def _ref_play_hand(hand: list[int], d_rank: int, draw) -> tuple[int, float]:
+    """Mirrors simulator._play_single_hand."""
+    if len(hand) == 2:
+        hand_val, is_soft = _hand_total(hand)
+        do_double = False
+        if is_soft:
+            if hand_val in (17, 18) and d_rank in (2, 3, 4, 5): do_double = True
+        else:
+            if hand_val == 11: do_double = True
+            if hand_val == 10 and d_rank <= 8: do_double = True
+            if hand_val == 9 and d_rank in (2, 3, 4, 5): do_double = True
+        if do_double:
+            card = draw()
+            if card != -1: hand = hand + [card]
+            return _hand_total(hand)[0], 2.0
+
+    while True:
+        player_total, is_soft = _hand_total(hand)
+        if player_total >= 21: return player_total, 1.0
+        if is_soft:
+            stand = player_total >= 19 or (player_total == 18 and d_rank <= 7)
+        else:
+            stand = player_total >= 17 or (player_total >= 13 and d_rank <= 5) or \
+                    (player_total == 12 and d_rank in (3, 4, 5))
+        if stand: return player_total, 1.0
+        card = draw()
+        if card == -1: return player_total, 1.0
+        hand = hand + [card]
+
+def _ref_play_dealer(dealer: list[int], draw) -> list[int]:
+    while _hand_total(dealer)[0] < 17:
+        card = draw()
+        if card == -1: break
+        dealer = dealer + [card]
+    return dealer
+
+def _ref_resolve(player_total: int, dealer_total: int, multiplier: float) -> float:
+    if player_total > 21: return -multiplier
+    if dealer_total > 21 or player_total > dealer_total: return multiplier
+    if player_total < dealer_total: return -multiplier
+    return 0.0
+
+def _ref_should_surrender(p1: int, p2: int, d_rank: int, early: bool) -> bool:
+    """Mirrors simulator._should_surrender on card values."""
+    if 0 in (p1, p2): return False
+    hard_total = _hand_total([p1, p2])[0]
+    ace_up, ten_up = d_rank == 0, d_rank == TEN_CATEGORY
+    if early and ace_up: return 5 <= hard_total <= 7 or 12 <= hard_total <= 17
+    if early and ten_up: return 14 <= hard_total <= 16
+    if p1 == 7 and p2 == 7: return False
+    if hard_total == 16: return ace_up or ten_up or d_rank == 8
+    return hard_total == 15 and ten_up
+
+def _ref_true_count(remaining: list[int]) -> float:
+    """Mirrors numba_utils.hilo_true_count on value-level counts."""
+    left = sum(remaining)
+    if left == 0: return 0.0
+    return -sum(tag * n for tag, n in zip(HILO_TAGS, remaining)) * 52.0 / left
+
+def _ref_round(draw: _ScriptedDraws, surrender: str = "none", insurance_tc: float | None = None) -> tuple[float, ...]:
+    """
+    Mirrors simulator._simulate_round and returns the outcomes in
+    MAIN_GAME_BETS order.
+    """
+    p1, p2, d1 = draw(), draw(), draw()
+    if -1 in (p1, p2, d1): return 0.0, 0.0, 0.0, 0.0, 0.0
+    player_total = _hand_total([p1, p2])[0]
+    insure = insurance_tc is not None and d1 == 0 and _ref_true_count(draw.remaining) >= insurance_tc
+    surrendered = surrender != "none" and _ref_should_surrender(p1, p2, d1, surrender == "early")
+    hole = draw()
+    if hole == -1: return 0.0, 0.0, 0.0, 0.0, 0.0
+    dealer = [d1, hole]
+    dealer_total = _hand_total(dealer)[0]
+    insurance = even_money = 0.0
+    if insure:
+        if player_total == 21: even_money = 1.0 if dealer_total == 21 else -0.5
+        else: insurance = 1.0 if dealer_total == 21 else -0.5
+    if player_total == 21: return (1.5 if dealer_total != 21 else 0.0), 0.0, 0.0, insurance, even_money
+    if dealer_total == 21:
+        if surrendered and surrender == "early": return -0.5, 0.0, 0.5, insurance, even_money
+        return -1.0, 0.0, 0.0, insurance, even_money
+
+    should_split = False
+    if p1 == p2:
+        up_val = _hand_total([d1])[0]
+        if p1 in (0, 7): should_split = True
+        if p1 == 8 and up_val not in (7, 10, 11): should_split = True
+        if p1 in (1, 2, 6) and up_val <= 7: should_split = True
+        if p1 == 5 and up_val <= 6: should_split = True
+
+    if should_split:
+        c1, c2 = draw(), draw()
+        if -1 in (c1, c2): return 0.0, 0.0, 0.0, insurance, even_money
+        total1, mult1 = _ref_play_hand([p1, c1], d1, draw)
+        total2, mult2 = _ref_play_hand([p1, c2], d1, draw)
+        dealer = _ref_play_dealer(dealer, draw)
+        dealer_final = _hand_total(dealer)[0]
+        main = _ref_resolve(total1, dealer_final, mult1) + _ref_resolve(total2, dealer_final, mult2)
+    else:
+        total, mult = _ref_play_hand([p1, p2], d1, draw)
+        dealer = _ref_play_dealer(dealer, draw)
+        main = _ref_resolve(total, _hand_total(dealer)[0], mult)
+
+    bust = -1.0
+    if _hand_total(dealer)[0] > 21:
+        bust = {3: 1.0, 4: 2.0}.get(len(dealer), 15.0 if len(dealer) >= 5 else -1.0)
+    surrender_gain = 0.0
+    if surrendered: main, surrender_gain = -0.5, -0.5 - main
+    return main, bust, surrender_gain, insurance, even_money
+
+def exact_main_game(
+    category_counts: list[int], surrender: str = "none", insurance_tc: float | None = None,
+    max_paths: int = 5_000_000
+) -> dict[str, tuple[float, float]]:
+    """
+    Exact (mean, variance) of each of MAIN_GAME_BETS by enumerating every
+    draw sequence of a round from a value-level shoe (10 categories, A..9
+    then tens). surrender and insurance_tc are FastSimulator's rule arguments.
+
+    Raises:
+        RuntimeError: If the shoe has more than max_paths distinct rounds.
+    """
+    moments = [[0.0, 0.0] for _ in MAIN_GAME_BETS]
+    stack: list[tuple[int, ...]] = [()]
+    paths = 0
+    while stack:
+        script = stack.pop()
+        draws = _ScriptedDraws(category_counts, script)
+        try:
+            outcomes = _ref_round(draws, surrender, insurance_tc)
+        except _NeedDraw:
+            options = [c for c, n in enumerate(draws.remaining) if n > 0] or [-1]
+            stack.extend(script + (c,) for c in options)
+            continue
+        paths += 1
+        if paths > max_paths:
+            raise RuntimeError(f"Shoe has more than {max_paths} distinct rounds; use fewer card values.")
+        for k, value in enumerate(outcomes):
+            moments[k][0] += draws.probability * value
+            moments[k][1] += draws.probability * value * value
+    return {key: (m, max(m2 - m * m, 0.0)) for key, (m, m2) in zip(MAIN_GAME_BETS, moments)}
+
+def card_level_shoe(category_counts: list[int]) -> np.ndarray:
+    """Spreads value-level counts across suits (and tens across 10-K) as evenly as possible."""
+    shoe_counts = np.zeros(52, dtype=np.int32)
+    for category, count in enumerate(category_counts):
+        ranks = (9, 10, 11, 12) if category == TEN_CATEGORY else (category,)
+        slots = [suit * 13 + rank for rank in ranks for suit in range(4)]
+        for i, idx in enumerate(slots):
+            shoe_counts[idx] = count // len(slots) + (1 if i < count % len(slots) else 0)
+    return shoe_counts
+
+def shoe_from_counts(shoe_counts: np.ndarray) -> shoe.Shoe:
+    """Builds a Shoe holding exactly the given 52-element card counts."""
+    ranks = ["A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"]
+    suits = ["S", "H", "D", "C"]
+    result = shoe.Shoe(decks=max(1, int(shoe_counts.max())))
+    for i, count in enumerate(shoe_counts):
+        for _ in range(result.decks - int(count)):
+            result.remove_card(f"{ranks[i % 13]}{suits[i // 13]}")
+    return result
+
+# --- Compositions ---
+
+def main_game_compositions(quick: bool = False) -> list[tuple[str, list[int]]]:
+    """Reduced shoes (three or four card values) small enough to enumerate exactly."""
+    def comp(values: dict[str, int]) -> list[int]:
+        counts = [0] * 10
+        for name, n in values.items(): counts[VALUE_NAMES.index(name)] = n
+        return counts
+    compositions = [
+        ("T16 6x4 A4", comp({"10": 16, "6": 4, "A": 4})),
+        ("T16 5x4 9x4 A4", comp({"10": 16, "5": 4, "9": 4, "A": 4})),
+        ("T8 8x8 3x8", comp({"10": 8, "8": 8, "3": 8})),
+        ("T12 7x6 4x6", comp({"10": 12, "7": 6, "4": 6})),
+        ("T12 9x4 2x4 A2", comp({"10": 12, "9": 4, "2": 4, "A": 2})),
+        ("T4 6x2 A2 (runs dry)", comp({"10": 4, "6": 2, "A": 2})),
+    ]
+    return compositions[:3] + compositions[-1:] if quick else compositions
+
+def side_bet_compositions(quick: bool = False) -> list[tuple[str, np.ndarray]]:
+    """Full-deck shoes with assorted removals, including rank- and suit-skewed ones."""
+    rng = random.Random(2024)
+    compositions = []
+    for decks in ((1, 6) if quick else (1, 2, 6, 8)):
+        compositions.append((f"{decks} decks fresh", simulator.FastSimulator(shoe.Shoe(decks).get_remaining_cards()).shoe_counts))
+    for fraction in ((0.5,) if quick else (0.25, 0.5, 0.75)):
+        s = shoe.Shoe(6)
+        for _ in range(int(s.total_cards * fraction)): s.draw_random_card()
+        compositions.append((f"6 decks, {fraction:.0%} random removal", simulator.FastSimulator(s.get_remaining_cards()).shoe_counts))
+    no_tens = simulator.FastSimulator(shoe.Shoe(2).get_remaining_cards()).shoe_counts.copy()
+    for suit in range(4):
+        for rank in (9, 10, 11, 12): no_tens[suit * 13 + rank] = 0
+    compositions.append(("2 decks, no tens", no_tens))
+    hearts_rich = simulator.FastSimulator(shoe.Shoe(2).get_remaining_cards()).shoe_counts.copy()
+    for idx in range(52):
+        if idx // 13 != 1: hearts_rich[idx] = rng.randint(0, 1)
+    compositions.append(("2 decks, hearts rich", hearts_rich))
+    return compositions
+
+# --- Suite ---
+
+class ValidationResult:
+    def __init__(self, name: str, bet: str, simulated: float, exact: float, std_error: float, z: float):
+        self.name = name
+        self.bet = bet
+        self.simulated = simulated
+        self.exact = exact
+        self.std_error = std_error
+        self.z_score = (simulated - exact) / std_error if std_error > 0 else (0.0 if simulated == exact else math.inf)
+        self.passed = abs(self.z_score) <= z
+
+    def __str__(self) -> str:
+        status = "ok  " if self.passed else "FAIL"
+        return (f"{status} {self.name:<32} {self.bet:<17} sim {self.simulated:+.5f}  "
+                f"exact {self.exact:+.5f}  z {self.z_score:+.2f}")
+
+def _check(results: list, name: str, bet: str, simulated: float, exact: tuple[float, float], rounds: int, z: float) -> None:
+    mean, variance = exact
+    results.append(ValidationResult(name, bet, simulated, mean, math.sqrt(variance / rounds), z))
+
+def run_suite(rounds: int = 400_000, z: float = 4.0, quick: bool = False, seed: int = 1) -> list[ValidationResult]:
+    """Runs every check and returns the results (see ValidationResult.passed)."""
+    results: list[ValidationResult] = []
+
+    for name, categories in main_game_compositions(quick):
+        shoe_counts = card_level_shoe(categories)
+        exact = {**exact_main_game(categories), **exact_side_bets(shoe_counts)}
+        sim = simulator.FastSimulator(shoe_from_counts(shoe_counts).get_remaining_cards())
+        means = sim.run_accumulated(rounds, seed=seed).mean()
+        for bet in ("main_ev", "bust_ev", "21+3_ev", "perfect_pairs_ev", "hot3_ev"):
+            _check(results, f"FastSimulator {name}", bet, means[bet], exact[bet], rounds, z)
+
+        for surrender, insurance_tc in RULE_CASES:
+            exact = exact_main_game(categories, surrender, insurance_tc)
+            sim = simulator.FastSimulator(shoe_from_counts(shoe_counts).get_remaining_cards(), surrender, insurance_tc)
+            means = sim.run_accumulated(rounds, seed=seed).mean()
+            for bet in MAIN_GAME_BETS:
+                _check(results, f"{surrender} surrender, ins {insurance_tc:g} {name}", bet, means[bet], exact[bet], rounds, z)
+
+    for name, shoe_counts in side_bet_compositions(quick):
+        exact = exact_side_bets(shoe_counts)
+        means = bayesian_predictor.run_side_bet_simulation(shoe_from_counts(shoe_counts), num_rounds=rounds)
+        for bet in ("21+3_ev", "perfect_pairs_ev", "hot3_ev"):
+            _check(results, f"side bets {name}", bet, float(means[bet]), exact[bet], rounds, z)
+
+    # Determinism: totals must not depend on the block size or on where a run
+    # is split into start_round slices (the thread count only changes which
+    # thread plays a block, so it is not varied here).
+    shoe_counts = simulator.FastSimulator(shoe.Shoe(6).get_remaining_cards()).shoe_counts
+    n = rounds // 4
+    whole = simulator.simulate_chunk(shoe_counts, n, seed, 0)
+    for block_rounds, cut in ((1, n // 2), (997, n // 3), (simulator.BLOCK_ROUNDS, n // 5 + 1), (n, n - 1)):
+        split = simulator.simulate_chunk(shoe_counts, cut, seed, 0, block_rounds) + \
+                simulator.simulate_chunk(shoe_counts, n - cut, seed, cut, block_rounds)
+        same = np.array_equal(whole, split)
+        results.append(ValidationResult(f"chunking invariance, blocks of {block_rounds}, cut at {cut}",
+                                        "all", 0.0 if same else 1.0, 0.0, 0.0, z))
+    return results
+
+def main(argv: list[str] | None = None) -> int:
+    parser = argparse.ArgumentParser(description="Validate the simulators against exact results.")
+    parser.add_argument("--rounds", type=int, default=400_000, help="Simulated rounds per composition.")
+    parser.add_argument("--z", type=float, default=4.0, help="Allowed deviation in standard errors.")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--quick", action="store_true")
+    args = parser.parse_args(argv)
+
+    results = run_suite(args.rounds, args.z, args.quick, args.seed)
+    for result in results: print(result)
+    failures = [r for r in results if not r.passed]
+    print(f"\n{len(results) - len(failures)}/{len(results)} checks passed.")
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
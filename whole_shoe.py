@@ -0,0 +1,210 @@
+"""
+Whole-shoe engine. Instead of asking "what is the EV of the next round from
+this composition", it deals consecutive rounds from the current shoe without
+putting the cards back, so composition, count and penetration evolve the way
+they do at a real table (optionally with other players, each with their own strategy, consuming cards).
+
+forecast_shoe() deals the next N rounds along many independent paths and
+summarizes, round by round, the expected EV, the spread of the per-round EV
+(estimated from the Hi-Lo true count at the start of each round) and the
+cumulative advantage. It is sized to run between two rounds.
+"""
+from __future__ import annotations
+import random
+from typing import TYPE_CHECKING, Sequence
+
+import numpy as np
+from numba import njit, prange, parallel_chunksize
+
+from numba_utils import (
+    SHOE_TOTAL, hilo_true_count, make_scratch_shoe, make_undo_log, restore_scratch_shoe,
+    rng_stream_state, rng_uniform,
+)
+import simulator
+from simulator import MAX_SPOTS, NUM_BETS, num_blocks, _simulate_round, _simulate_spots_round
+
+if TYPE_CHECKING:
+    from shoe import Shoe
+
+FORECAST_QUANTILES = (5, 25, 50, 75, 95)
+PATHS_PER_BLOCK = 32
+
+def bet_ramp(tc_min: int, tc_max: int, bet_spread: dict[int, float] | None = None) -> np.ndarray:
+    """
+    Bet in units for each floored true count from tc_min to tc_max. bet_spread
+    maps a true count to the bet from that count up; counts below the lowest
+    key bet that key's amount. The default is a flat 1 unit.
+    """
+    bets = np.ones(tc_max - tc_min + 1)
+    if bet_spread:
+        keys = sorted(bet_spread)
+        for i in range(bets.shape[0]):
+            eligible = [k for k in keys if k <= i + tc_min]
+            bets[i] = bet_spread[eligible[-1] if eligible else keys[0]]
+    return bets
+
+@njit(parallel=True)
+def forecast_paths(
+    shoe_counts: np.ndarray, n_rounds: int, n_paths: int, seed: int, min_cards: int,
+    seats_before: np.ndarray, seats_after: np.ndarray
+) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """
+    Deals up to n_rounds consecutive rounds along n_paths independent paths,
+    stopping a path once fewer than min_cards remain (the cut card). Returns
+    (paths, rounds) arrays of the main-bet outcome, the true count at the start
+    of the round and the cards left at the start of the round; rounds not
+    played are NaN (outcome, true count) and 0 (cards left). seats_before and
+    seats_after hold the SEAT_* strategy codes of the other players.
+    """
+    outcomes = np.full((n_paths, n_rounds), np.nan)
+    true_counts = np.full((n_paths, n_rounds), np.nan)
+    cards_left = np.zeros((n_paths, n_rounds), dtype=np.int64)
+    capacity = int(np.sum(shoe_counts))
+    n_blocks = num_blocks(n_paths, PATHS_PER_BLOCK)
+
+    with parallel_chunksize(1):
+        for b in prange(n_blocks):
+            rng = np.zeros(1, dtype=np.uint64)
+            row = np.zeros(NUM_BETS, dtype=np.float64)
+            scratch = make_scratch_shoe(shoe_counts)
+            undo_log = make_undo_log(capacity)
+            for p in range((n_paths * b) // n_blocks, (n_paths * (b + 1)) // n_blocks):
+                rng[0] = rng_stream_state(seed, p)
+                for r in range(n_rounds):
+                    if scratch[SHOE_TOTAL] < max(min_cards, 1): break
+                    cards_left[p, r] = scratch[SHOE_TOTAL]
+                    true_counts[p, r] = hilo_true_count(scratch)
+                    row[:] = 0.0
+                    _simulate_round(scratch, undo_log, rng, row, None, seats_before, seats_after)
+                    outcomes[p, r] = row[0]
+                restore_scratch_shoe(scratch, undo_log)
+    return outcomes, true_counts, cards_left
+
+@njit(parallel=True)
+def deal_tables(
+    shoe_counts: np.ndarray, n_tables: int, n_ticks: int, n_spots: int, seed: int, first_table: int,
+    min_cards: int, shuffle_ticks: int, seats_before: np.ndarray, seats_after: np.ndarray
+) -> tuple[np.ndarray, np.ndarray]:
+    """
+    Deals n_ticks consecutive rounds at each of n_tables independent tables,
+    one round per table per tick, all starting from the full shoe shoe_counts.
+    Each table first deals a uniformly random share of its shoe unrecorded, so
+    the tables are out of phase, and reshuffles at the cut card, which takes
+    shuffle_ticks ticks without a round. Every table seats n_spots spots plus
+    the other players whether or not anyone is watching, so card flow does not
+    depend on who sits where. Returns (tables, ticks) true counts at the start
+    of each round (NaN while shuffling) and (tables, ticks, n_spots) main-bet
+    outcomes (0.0 while shuffling). Table t uses stream first_table + t.
+    """
+    true_counts = np.full((n_tables, n_ticks), np.nan)
+    outcomes = np.zeros((n_tables, n_ticks, n_spots))
+    capacity = int(np.sum(shoe_counts))
+    cut = max(min_cards, 1)
+
+    with parallel_chunksize(1):
+        for t in prange(n_tables):
+            rng = np.zeros(1, dtype=np.uint64)
+            rng[0] = rng_stream_state(seed, first_table + t)
+            scratch = make_scratch_shoe(shoe_counts)
+            undo_log = make_undo_log(capacity)
+            first_cards = np.zeros((MAX_SPOTS, 2), dtype=np.int64)
+            hands = np.zeros((MAX_SPOTS, 4), dtype=np.float64)
+            row = np.zeros(MAX_SPOTS, dtype=np.float64)
+
+            burn = int(rng_uniform(rng) * max(capacity - cut, 0))
+            while capacity - scratch[SHOE_TOTAL] < burn and scratch[SHOE_TOTAL] >= cut:
+                _simulate_spots_round(scratch, undo_log, rng, n_spots, first_cards, hands, row, seats_before, seats_after)
+
+            shuffling = 0
+            for r in range(n_ticks):
+                if shuffling == 0 and scratch[SHOE_TOTAL] < cut:
+                    restore_scratch_shoe(scratch, undo_log)
+                    shuffling = shuffle_ticks
+                if shuffling > 0:
+                    shuffling -= 1
+                    continue
+                true_counts[t, r] = hilo_true_count(scratch)
+                _simulate_spots_round(scratch, undo_log, rng, n_spots, first_cards, hands, row, seats_before, seats_after)
+                outcomes[t, r, :] = row[:n_spots]
+    return true_counts, outcomes
+
+class ShoeForecast:
+    """Per-path results of forecast_paths with round-by-round summaries."""
+    def __init__(self, outcomes: np.ndarray, true_counts: np.ndarray, cards_left: np.ndarray):
+        self.outcomes = outcomes
+        self.true_counts = true_counts
+        self.cards_left = cards_left
+        self.played = ~np.isnan(outcomes)
+
+    @property
+    def n_paths(self) -> int:
+        return self.outcomes.shape[0]
+
+    @property
+    def n_rounds(self) -> int:
+        return self.outcomes.shape[1]
+
+    def ev_by_true_count(self) -> tuple[float, float]:
+        """Least-squares (intercept, slope) of the round outcome on the starting true count."""
+        tc, outcome = self.true_counts[self.played], self.outcomes[self.played]
+        if tc.size < 2 or np.ptp(tc) == 0: return float(outcome.mean()) if outcome.size else 0.0, 0.0
+        slope, intercept = np.polyfit(tc, outcome, 1)
+        return float(intercept), float(slope)
+
+    def round_summary(self) -> list[dict]:
+        """
+        For each future round: the share of paths still before the cut card, the
+        expected EV with its standard error, quantiles of the per-round EV
+        estimated from the starting true count, and the mean and quantiles of
+        the cumulative result up to that round.
+        """
+        intercept, slope = self.ev_by_true_count()
+        cumulative = np.cumsum(np.where(self.played, self.outcomes, 0.0), axis=1)
+        rows = []
+        for r in range(self.n_rounds):
+            mask = self.played[:, r]
+            n = int(mask.sum())
+            row = {"round": r + 1, "p_dealt": n / self.n_paths}
+            if n:
+                outcome = self.outcomes[mask, r]
+                estimated_ev = intercept + slope * self.true_counts[mask, r]
+                row.update({
+                    "ev": float(outcome.mean()),
+                    "std_error": float(outcome.std(ddof=1) / np.sqrt(n)) if n > 1 else 0.0,
+                    "mean_true_count": float(self.true_counts[mask, r].mean()),
+                    "p_positive_ev": float((estimated_ev > 0).mean()),
+                    "ev_quantiles": dict(zip(FORECAST_QUANTILES, np.percentile(estimated_ev, FORECAST_QUANTILES).tolist())),
+                })
+            row["cumulative_mean"] = float(cumulative[:, r].mean())
+            row["cumulative_quantiles"] = dict(zip(FORECAST_QUANTILES, np.percentile(cumulative[:, r], FORECAST_QUANTILES).tolist()))
+            rows.append(row)
+        return rows
+
+    def to_dict(self) -> dict:
+        intercept, slope = self.ev_by_true_count()
+        return {"paths": self.n_paths, "rounds": self.n_rounds,
+                "ev_intercept": intercept, "ev_per_true_count": slope, "by_round": self.round_summary()}
+
+def forecast_shoe(
+    shoe: 'Shoe',
+    n_rounds: int = 10,
+    n_paths: int = 4_000,
+    penetration: float = 0.75,
+    others_before: int | Sequence[str] = 0,
+    others_after: int | Sequence[str] = 0,
+    seed: int | None = None
+) -> ShoeForecast:
+    """
+    Forecasts the next n_rounds from the current shoe. The cut card sits after
+    `penetration` of the full shoe; paths stop once it is reached.
+    others_before / others_after are the other players acting before and after
+    us: a number of basic-strategy players, or a list of strategy names from
+    simulator.SEAT_STRATEGIES ("basic", "never_bust", "mimic_dealer").
+    """
+    if not 0.0 < penetration <= 1.0:
+        raise ValueError("Penetration must be in (0, 1].")
+    shoe_counts = simulator.FastSimulator(shoe.get_remaining_cards()).shoe_counts
+    min_cards = int(round(shoe.initial_card_count * (1.0 - penetration)))
+    seed = random.getrandbits(63) if seed is None else seed
+    return ShoeForecast(*forecast_paths(shoe_counts, n_rounds, n_paths, seed, min_cards,
+                                        simulator.seat_codes(others_before), simulator.seat_codes(others_after)))